@@ -11,19 +11,50 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if __has_include(<version>)
+#include <version>
+#endif
+
 #ifdef __cpp_lib_concepts
 #include <concepts>
 #endif
 
+#ifdef __cpp_lib_span
+#include <span>
+#endif
+
+#ifdef __cpp_lib_coroutine
+#include <coroutine>
+#endif
+
 namespace linq {
 /**
  * Defines a direction for sorting ranges.
@@ -40,269 +71,3179 @@ enum class sort_direction {
   descending
 };
 
-namespace details {
 // ----------------------------------
-// Range declarations
+// Executors
 // ----------------------------------
 
-template <typename TPrevRange, typename TPredicate>
-class where_range;
+/*
+ * Parallel operators don't spawn threads themselves; they hand their work to an executor.
+ * An executor is any object that provides:
+ *
+ *   size_t concurrency() const;
+ *     The number of tasks that may run at the same time, including the calling thread.
+ *
+ *   void bulk(size_t task_count, const F& func);
+ *     Invokes func(i) for every i in [0, task_count), possibly concurrently, and returns
+ *     once all invocations have finished.
+ *
+ * linq ships with a work-stealing thread_pool, which is used by default, and an inline_executor.
+ * To avoid oversubscribing cores, wrap an existing thread pool in a type that provides both functions.
+ */
 
-template <typename TPrevRange>
-class distinct_range;
+/**
+ * @brief A work-stealing thread pool that executes the parallel operators of linq.
+ *
+ * Every worker owns a deque of tasks. A worker pops tasks from the back of its own
+ * deque and steals from the front of other workers' deques once it runs dry.
+ * Tasks that are submitted from within a worker (nested parallel queries) are pushed
+ * to that worker's own deque, so they stay local unless another worker is idle.
+ * A thread that waits for its tasks to finish helps executing queued tasks meanwhile.
+ */
+class thread_pool {
+public:
+  explicit thread_pool(size_t worker_count)
+      : m_queues(std::max(worker_count, size_t{1})) {
+    for (auto& queue : m_queues) {
+      queue = std::make_unique<task_queue>();
+    }
 
-template <typename TPrevRange, typename TTransform>
-class select_range;
+    m_workers.reserve(worker_count);
 
-template <typename TPrevRange>
-class select_to_string_range;
+    for (size_t i = 0; i < worker_count; ++i) {
+      m_workers.emplace_back([this, i] { worker_main(i); });
+    }
+  }
 
-template <typename TPrevRange, typename TTransform>
-class select_many_range;
+  thread_pool(const thread_pool&)            = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
 
-template <typename TPrevRange>
-class reverse_range;
+  ~thread_pool() {
+    {
+      std::lock_guard lock{m_sleep_mutex};
+      m_stop = true;
+    }
 
-template <typename TPrevRange>
-class take_range;
+    m_wake_up.notify_all();
 
-template <typename TPrevRange, typename TPredicate>
-class take_while_range;
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+  }
 
-template <typename TPrevRange>
-class skip_range;
+  /**
+   * @brief Gets the number of threads that take part in a bulk operation,
+   * including the thread that submits it.
+   */
+  [[nodiscard]] size_t concurrency() const {
+    return m_workers.size() + 1;
+  }
 
-template <typename TPrevRange, typename TPredicate>
-class skip_while_range;
+  /**
+   * @brief Invokes func(i) for every i in [0, task_count) and waits until all invocations have finished.
+   * The first exception that is thrown by an invocation is rethrown once all invocations have finished.
+   */
+  template <typename TFunc>
+  void bulk(size_t task_count, const TFunc& func) {
+    if (task_count == 0) {
+      return;
+    }
 
-template <typename TPrevRange, typename TOtherRange>
-class append_range;
+    bulk_state state{task_count};
 
-template <typename TPrevRange>
-class repeat_range;
+    const auto invoke = [](const void* f, size_t index) { (*static_cast<const TFunc*>(f))(index); };
 
-template <typename TPrevRange,
-          typename TOtherRange,
-          typename TKeySelectorA,
-          typename TKeySelectorB,
-          typename TTransform>
-class join_range;
+    push_tasks(invoke, std::addressof(func), &state, task_count);
 
-template <typename TPrevRange, typename TKeySelector>
-class order_by_range;
+    // The submitting thread takes the first task itself.
+    run_task(task{invoke, std::addressof(func), &state, 0});
 
-template <typename TPrevRange, typename TKeySelector>
-class then_by_range;
+    while (state.remaining.load(std::memory_order_acquire) != 0) {
+      if (!try_run_one()) {
+        std::this_thread::yield();
+      }
+    }
 
-// ----------------------------------
-// Average calculators
-// ----------------------------------
+    if (state.error) {
+      std::rethrow_exception(state.error);
+    }
+  }
 
-#ifdef __cpp_lib_concepts
-template <typename T>
-concept number = std::integral<T> || std::floating_point<T>;
+private:
+  struct bulk_state {
+    explicit bulk_state(size_t count)
+        : remaining(count) {
+    }
 
-template <typename T>
-concept averageable = requires(T a, T b, size_t c) {
-  { a / c } -> std::same_as<T>;
-  a += b;
-};
+    std::atomic<size_t> remaining;
+    std::mutex          error_mutex;
+    std::exception_ptr  error;
+  };
 
-template <typename T>
-concept addable = requires(T a, T b) {
-  std::is_convertible_v<int, T>;
-  a += b;
-  a < b;
-};
-#endif
+  struct task {
+    void (*invoke)(const void*, size_t);
+    const void* func;
+    bulk_state* state;
+    size_t      index;
+  };
 
-template <typename T, typename TRange>
-#ifdef __cpp_lib_concepts
-  requires(averageable<T> || number<T>)
-#endif
-static auto calculate_average(const TRange& op) {
-  using float_type = long double;
-  using output_t   = typename TRange::output_t;
+  struct task_queue {
+    std::mutex       mutex;
+    std::deque<task> tasks;
+  };
 
-#ifdef __cpp_lib_concepts
-  using return_t = std::conditional_t<number<output_t>, float_type, output_t>;
-#else
-  using return_t =
-      std::conditional_t<std::is_integral<output_t>::value || std::is_floating_point_v<output_t>, float_type, output_t>;
-#endif
+  void push_tasks(void (*invoke)(const void*, size_t), const void* func, bulk_state* state, size_t task_count) {
+    if (task_count < 2) {
+      return;
+    }
 
-  if (const auto maybe_sum_and_count = op.sum_and_count()) {
-    const auto& sum_and_count = *maybe_sum_and_count;
-    return std::optional<return_t>{static_cast<return_t>(sum_and_count.first) / sum_and_count.second};
+    if (t_current_pool == this) {
+      // Nested submission: keep the tasks local to the current worker.
+      auto& queue = *m_queues[t_worker_index];
+
+      std::lock_guard lock{queue.mutex};
+      for (size_t i = 1; i < task_count; ++i) {
+        queue.tasks.push_back(task{invoke, func, state, i});
+      }
+    }
+    else {
+      for (size_t i = 1; i < task_count; ++i) {
+        auto& queue = *m_queues[m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size()];
+
+        std::lock_guard lock{queue.mutex};
+        queue.tasks.push_back(task{invoke, func, state, i});
+      }
+    }
+
+    {
+      std::lock_guard lock{m_sleep_mutex};
+      m_queued.fetch_add(task_count - 1, std::memory_order_release);
+    }
+
+    m_wake_up.notify_all();
   }
 
-  return std::optional<return_t>{};
-}
+  static void run_task(const task& t) {
+    try {
+      t.invoke(t.func, t.index);
+    }
+    catch (...) {
+      std::lock_guard lock{t.state->error_mutex};
 
-// ----------------------------------
-// base_range
-// ----------------------------------
+      if (!t.state->error) {
+        t.state->error = std::current_exception();
+      }
+    }
 
-// Base class to identify all range types (for compile-time type checking).
-class base_range_ident {
-  /* Nothing to define here. */
-};
+    t.state->remaining.fetch_sub(1, std::memory_order_acq_rel);
+  }
 
-// Base class for sorting ranges (for compile-time type checking).
-class sorting_range {
-  /* Nothing to define here. */
+  // Pops a task from the back of the own deque or steals one from the front of another deque.
+  bool try_run_one() {
+    const size_t queue_count = m_queues.size();
+    const bool   is_worker   = t_current_pool == this;
+    const size_t home        = is_worker ? t_worker_index : 0;
+
+    for (size_t i = 0; i < queue_count; ++i) {
+      auto&      queue     = *m_queues[(home + i) % queue_count];
+      const bool from_back = is_worker && i == 0;
+      task       stolen_task{};
+      bool       have_task = false;
+
+      {
+        std::lock_guard lock{queue.mutex};
+
+        if (!queue.tasks.empty()) {
+          if (from_back) {
+            stolen_task = queue.tasks.back();
+            queue.tasks.pop_back();
+          }
+          else {
+            stolen_task = queue.tasks.front();
+            queue.tasks.pop_front();
+          }
+
+          have_task = true;
+        }
+      }
+
+      if (have_task) {
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        run_task(stolen_task);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void worker_main(size_t index) {
+    t_current_pool = this;
+    t_worker_index = index;
+
+    for (;;) {
+      if (try_run_one()) {
+        continue;
+      }
+
+      std::unique_lock lock{m_sleep_mutex};
+      m_wake_up.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) != 0; });
+
+      if (m_stop) {
+        return;
+      }
+    }
+  }
+
+  static inline thread_local const thread_pool* t_current_pool = nullptr;
+  static inline thread_local size_t             t_worker_index = 0;
+
+  std::vector<std::unique_ptr<task_queue>> m_queues;
+  std::vector<std::thread>                 m_workers;
+  std::atomic<size_t>                      m_next_queue{0};
+  std::atomic<size_t>                      m_queued{0};
+  std::mutex                               m_sleep_mutex;
+  std::condition_variable                  m_wake_up;
+  bool                                     m_stop{false};
 };
 
 /**
- * @brief Represents the base class of all LINQ ranges.
- * @tparam TOutput The full, unmodified type that is returned by the range.
+ * @brief Gets the thread pool that is shared by all parallel operators.
+ * The pool is started on first use and uses one worker less than there are hardware threads,
+ * since the thread that runs a parallel query takes part in it.
  */
-template <typename /*TMy*/, typename TOutput>
-class base_range : public base_range_ident {
+inline thread_pool& default_thread_pool() {
+  static thread_pool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+  return pool;
+}
+
+/**
+ * @brief An executor that runs all tasks on the calling thread, one after another.
+ * Useful for tests and for running parallel operators deterministically.
+ */
+class inline_executor {
 public:
-  // Return non-const, non-volatile, non-reference types from methods such as sum, min and max.
-  using output_t = std::decay_t<TOutput>;
+  [[nodiscard]] size_t concurrency() const {
+    return 1;
+  }
 
-  /**
-   * @brief Appends a filter to the range.
-   * @tparam TPredicate The type of the predicate: f(x) -> bool
-   * @param predicate The predicate
-   * @return A new range that combines this range with the where-range.
-   */
-  template <typename TPredicate>
-  [[nodiscard]] auto where(TPredicate&& predicate) const;
+  template <typename TFunc>
+  void bulk(size_t task_count, const TFunc& func) const {
+    for (size_t i = 0; i < task_count; ++i) {
+      func(i);
+    }
+  }
+};
 
-  /**
-   * @brief Appends a distinct-filter to the range that removes duplicate elements.
-   * @return A new range that combines this range with the distinct-range.
-   */
-  [[nodiscard]] auto distinct() const;
+#ifdef __cpp_lib_concepts
+template <typename T>
+concept executor = requires(T& e, size_t task_count, void (*func)(size_t)) {
+  { e.concurrency() } -> std::convertible_to<size_t>;
+  e.bulk(task_count, func);
+};
+#endif
 
-  template <typename TTransform>
-  [[nodiscard]] auto select(TTransform&& transform) const;
+// ----------------------------------
+// Execution contexts
+// ----------------------------------
 
-  [[nodiscard]] auto select_to_string() const;
+/**
+ * @brief Keeps the scratch memory of queries alive across executions.
+ *
+ * Pass the allocator of a context to the operators that buffer elements and to the
+ * terminals that produce containers (see "Allocators"). Memory that is released by them
+ * returns to the context instead of the heap, and is handed out again on the next execution.
+ * Once a query has run with its largest input, re-running it (or a copy of it) doesn't
+ * allocate from the heap anymore.
+ *
+ * The context retains the most memory that was ever in use at once (its high-water mark)
+ * until trim() is called. It is not thread-safe, and must outlive the queries that use it.
+ * The parallel operators that accept an allocator only allocate on the calling thread, so they
+ * can be given a context as well.
+ *
+ * Example:
+ * @code{.cpp}
+ * linq::execution_context context;
+ * const auto query = linq::from(&rows).order_by_ascending(key, context.get_allocator());
+ *
+ * for (;;) {
+ *   auto top = query.take(10).to_vector(context.get_allocator()); // no heap allocations after the first run
+ * }
+ * @endcode
+ */
+class execution_context {
+public:
+  template <typename T>
+  class allocator {
+  public:
+    using value_type = T;
 
-  template <typename TTransform>
-  [[nodiscard]] auto select_many(TTransform&& transform) const;
+    explicit allocator(execution_context* context)
+        : m_context(context) {
+    }
 
-  [[nodiscard]] auto reverse() const;
+    template <typename U>
+    allocator(const allocator<U>& other)
+        : m_context(other.context()) {
+    }
 
-  [[nodiscard]] auto take(size_t count) const;
+    [[nodiscard]] T* allocate(size_t count) {
+      if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+        throw std::bad_array_new_length();
+      }
 
-  template <typename TPredicate>
-  [[nodiscard]] auto take_while(TPredicate&& predicate) const;
+      return static_cast<T*>(m_context->allocate(count * sizeof(T), alignof(T)));
+    }
 
-  [[nodiscard]] auto skip(size_t count) const;
+    void deallocate(T* ptr, size_t count) {
+      m_context->deallocate(ptr, count * sizeof(T), alignof(T));
+    }
 
-  template <typename TPredicate>
-  [[nodiscard]] auto skip_while(TPredicate&& predicate) const;
+    execution_context* context() const {
+      return m_context;
+    }
 
-  template <typename TOtherRange>
-  [[nodiscard]] auto append(const TOtherRange& other_range) const;
+    template <typename U>
+    bool operator==(const allocator<U>& other) const {
+      return m_context == other.context();
+    }
 
-  [[nodiscard]] auto repeat(size_t count) const;
+    template <typename U>
+    bool operator!=(const allocator<U>& other) const {
+      return m_context != other.context();
+    }
 
-  template <typename TOtherRange, typename TKeySelectorA, typename TKeySelectorB, typename TTransform>
-  [[nodiscard]] auto join(const TOtherRange& other_range,
-                          TKeySelectorA&&    key_selector_a,
-                          TKeySelectorB&&    key_selector_b,
-                          TTransform&&       transform) const;
+  private:
+    execution_context* m_context;
+  };
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto order_by(TKeySelector&& key_selector, sort_direction sort_dir) const;
+  execution_context() = default;
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto order_by_ascending(TKeySelector&& key_selector) const {
-    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending);
+  execution_context(const execution_context&)            = delete;
+  execution_context& operator=(const execution_context&) = delete;
+
+  ~execution_context() {
+    trim();
   }
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto order_by_descending(TKeySelector&& key_selector) const {
-    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending);
+  [[nodiscard]] allocator<std::byte> get_allocator() {
+    return allocator<std::byte>(this);
   }
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto then_by(TKeySelector&& key_selector, sort_direction sort_dir) const;
+  /**
+   * @brief Returns retained memory to the heap until at most max_retained_bytes remain.
+   */
+  void trim(size_t max_retained_bytes = 0) {
+    for (size_t i = size_class_count; i-- > 0 && m_retained_bytes > max_retained_bytes;) {
+      while (m_free_blocks[i] && m_retained_bytes > max_retained_bytes) {
+        free_block* block = m_free_blocks[i];
+        m_free_blocks[i]  = block->next;
+        m_retained_bytes -= class_size(i);
+        ::operator delete(block);
+      }
+    }
+  }
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto then_by_ascending(TKeySelector&& key_selector) const {
-    return then_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending);
+  // The number of bytes that are currently held for reuse.
+  [[nodiscard]] size_t retained_bytes() const {
+    return m_retained_bytes;
   }
 
-  template <typename TKeySelector>
-  [[nodiscard]] auto then_by_descending(TKeySelector&& key_selector) const {
-    return then_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending);
+  // The number of times the context had to allocate from the heap.
+  [[nodiscard]] size_t heap_allocations() const {
+    return m_heap_allocations;
   }
 
-  [[nodiscard]] auto sum() const;
-  [[nodiscard]] auto min() const;
-  [[nodiscard]] auto max() const;
+private:
+  // Blocks are pooled in power-of-two size classes, starting at min_class_size.
+  // A free block stores the link to the next free block of its class in itself.
+  struct free_block {
+    free_block* next;
+  };
 
-  [[nodiscard]] auto sum_and_count() const;
+  static constexpr size_t min_class_size   = 64;
+  static constexpr size_t size_class_count = 48;
 
-  [[nodiscard]] auto average() const
-#ifdef __cpp_lib_concepts
-    requires(averageable<output_t> || number<output_t>)
-#endif
-  ;
+  static constexpr size_t class_size(size_t size_class) {
+    return min_class_size << size_class;
+  }
+
+  static size_t size_class_of(size_t size) {
+    size_t size_class = 0;
+
+    while (class_size(size_class) < size) {
+      ++size_class;
+    }
+
+    return size_class;
+  }
+
+  // Over-aligned and huge blocks bypass the pool.
+  static bool is_pooled(size_t size, size_t alignment) {
+    return alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ && size <= class_size(size_class_count - 1);
+  }
+
+  void* allocate(size_t size, size_t alignment) {
+    if (!is_pooled(size, alignment)) {
+      ++m_heap_allocations;
+      return ::operator new(size, std::align_val_t{alignment});
+    }
+
+    const size_t size_class = size_class_of(size);
+
+    if (free_block* block = m_free_blocks[size_class]) {
+      m_free_blocks[size_class] = block->next;
+      m_retained_bytes -= class_size(size_class);
+      return block;
+    }
+
+    ++m_heap_allocations;
+    return ::operator new(class_size(size_class));
+  }
+
+  void deallocate(void* ptr, size_t size, size_t alignment) {
+    if (!is_pooled(size, alignment)) {
+      ::operator delete(ptr, std::align_val_t{alignment});
+      return;
+    }
+
+    const size_t size_class = size_class_of(size);
+
+    m_free_blocks[size_class] = ::new (ptr) free_block{m_free_blocks[size_class]};
+    m_retained_bytes += class_size(size_class);
+  }
+
+  std::array<free_block*, size_class_count> m_free_blocks{};
+  size_t                                    m_retained_bytes{};
+  size_t                                    m_heap_allocations{};
+};
+
+// ----------------------------------
+// chunk_view
+// ----------------------------------
+
+/**
+ * @brief A non-owning view of consecutive elements, as produced by the chunk operator.
+ * @tparam T The type of the viewed elements
+ */
+template <typename T>
+class chunk_view {
+public:
+  using value_type     = T;
+  using const_iterator = const T*;
+
+  chunk_view() = default;
+
+  chunk_view(const T* data, size_t size)
+      : m_data(data)
+      , m_size(size) {
+  }
+
+  [[nodiscard]] const T* data() const {
+    return m_data;
+  }
+
+  [[nodiscard]] size_t size() const {
+    return m_size;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return m_size == 0;
+  }
+
+  [[nodiscard]] const T* begin() const {
+    return m_data;
+  }
+
+  [[nodiscard]] const T* end() const {
+    return m_data + m_size;
+  }
+
+  [[nodiscard]] const T& operator[](size_t index) const {
+    assert(index < m_size && "chunk index out of range");
+    return m_data[index];
+  }
+
+#ifdef __cpp_lib_span
+  operator std::span<const T>() const {
+    return std::span<const T>{m_data, m_size};
+  }
+#endif
+
+private:
+  const T* m_data{};
+  size_t   m_size{};
+};
+
+// ----------------------------------
+// Window aggregations
+// ----------------------------------
+
+/*
+ * Aggregations for window_aggregate(). Each one is updated in amortized constant time
+ * whenever the window slides by one element.
+ *
+ * Custom aggregations can be passed to window_aggregate() as well. They have to provide:
+ *   void push(const T& entering);   // called for every element that enters the window
+ *   void pop(const T& leaving);     // called for every element that leaves the window, oldest first
+ *   R    result() const;            // the aggregate of the current window
+ * They are copied for every iteration of the range, and don't receive the allocator that is passed
+ * to window_aggregate().
+ */
+
+// Sum of the window, kept as a running accumulator.
+struct rolling_sum {};
+
+// Average of the window, kept as a running accumulator.
+struct rolling_average {};
+
+// Minimum of the window, kept in a monotonic deque.
+struct rolling_min {};
+
+// Maximum of the window, kept in a monotonic deque.
+struct rolling_max {};
+
+// ----------------------------------
+// Number formatting
+// ----------------------------------
+
+/**
+ * @brief Determines how select_to_string_view formats floating-point numbers.
+ */
+struct float_format {
+  // Fixed, scientific, general (whichever is shorter) or hex notation.
+  std::chars_format notation = std::chars_format::general;
+
+  // The number of digits after the decimal point (fixed, scientific) or significant digits (general).
+  // If negative, the shortest representation that parses back to the same value is used.
+  int precision = -1;
+};
+
+/**
+ * @brief A number formatted by select_to_string_view, in a buffer owned by the iterator.
+ * It converts to a std::string_view, but can't be copied or moved, because the text is overwritten
+ * when the iterator is incremented. Operations that keep elements (first, to_vector, min, order_by, ...)
+ * therefore don't compile; convert to std::string first if the text is needed later.
+ */
+class formatted_text {
+public:
+  explicit formatted_text(std::string_view text)
+      : m_text(text) {
+  }
+
+  formatted_text(const formatted_text&)            = delete;
+  formatted_text& operator=(const formatted_text&) = delete;
+
+  operator std::string_view() const {
+    return m_text;
+  }
+
+  std::string_view view() const {
+    return m_text;
+  }
+
+  const char* data() const {
+    return m_text.data();
+  }
+
+  size_t size() const {
+    return m_text.size();
+  }
+
+  friend bool operator==(const formatted_text& lhs, std::string_view rhs) {
+    return lhs.m_text == rhs;
+  }
+
+  friend bool operator!=(const formatted_text& lhs, std::string_view rhs) {
+    return lhs.m_text != rhs;
+  }
+
+private:
+  std::string_view m_text;
+};
+
+#ifdef __cpp_lib_coroutine
+// ----------------------------------
+// Coroutine generators
+// ----------------------------------
+
+namespace details {
+template <typename T>
+class coroutine_range;
+} // namespace details
+
+template <typename T>
+class generator;
+
+/**
+ * @brief Makes co_yield yield all elements of another generator.
+ */
+template <typename T>
+struct elements_of {
+  explicit elements_of(generator<T> nested)
+      : range(std::move(nested)) {
+  }
+
+  generator<T> range;
+};
+
+template <typename T>
+elements_of(generator<T>) -> elements_of<T>;
+
+/**
+ * @brief The return type of coroutines that produce elements using co_yield, see from_coroutine().
+ *
+ * Yielded values are passed to the consumer by reference: the coroutine is suspended while the
+ * consumer reads the value, so neither values in the coroutine frame nor temporaries are copied.
+ * co_yield elements_of(other) yields the elements of another generator. The nested coroutine is
+ * resumed directly by the consumer and hands control back to this one when it's finished
+ * (symmetric transfer), so nesting doesn't add a resumption per element.
+ *
+ * Example:
+ * @code{.cpp}
+ * linq::generator<std::string_view> split(std::string_view text, char separator) {
+ *   while (!text.empty()) {
+ *     const auto pos = text.find(separator);
+ *     co_yield text.substr(0, pos);
+ *     text.remove_prefix(pos == text.npos ? text.size() : pos + 1);
+ *   }
+ * }
+ * @endcode
+ */
+template <typename T>
+class generator {
+  static_assert(!std::is_reference_v<T>, "generator yields references to T; T must not be a reference.");
+
+public:
+  class promise_type;
+
+  using handle_t = std::coroutine_handle<promise_type>;
+
+  class promise_type {
+  public:
+    generator get_return_object() noexcept {
+      return generator{handle_t::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+
+    auto final_suspend() noexcept {
+      struct final_awaiter {
+        bool await_ready() const noexcept {
+          return false;
+        }
+
+        // Continue with the generator that yielded this one, if any.
+        std::coroutine_handle<> await_suspend(handle_t handle) noexcept {
+          auto& promise = handle.promise();
+
+          if (promise.m_parent) {
+            promise.m_root->m_leaf = promise.m_parent;
+            return promise.m_parent;
+          }
+
+          return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {
+        }
+      };
+
+      return final_awaiter{};
+    }
+
+    std::suspend_always yield_value(const T& value) noexcept {
+      m_root->m_value = std::addressof(value);
+      return {};
+    }
+
+    auto yield_value(elements_of<T> nested) noexcept {
+      struct nested_awaiter {
+        bool await_ready() const noexcept {
+          return !m_nested.m_handle;
+        }
+
+        // Continue with the nested generator, which yields to the consumer directly.
+        std::coroutine_handle<> await_suspend(handle_t handle) noexcept {
+          auto& outer = handle.promise();
+          auto& inner = m_nested.m_handle.promise();
+
+          inner.m_root         = outer.m_root;
+          inner.m_parent       = handle;
+          outer.m_root->m_leaf = m_nested.m_handle;
+
+          return m_nested.m_handle;
+        }
+
+        void await_resume() const {
+          if (m_nested.m_handle && m_nested.m_handle.promise().m_exception) {
+            std::rethrow_exception(m_nested.m_handle.promise().m_exception);
+          }
+        }
+
+        generator m_nested;
+      };
+
+      return nested_awaiter{std::move(nested.range)};
+    }
+
+    void return_void() const noexcept {
+    }
+
+    void unhandled_exception() {
+      if (m_parent) {
+        // Rethrown in the generator that yielded this one.
+        m_exception = std::current_exception();
+      }
+      else {
+        throw;
+      }
+    }
+
+    // Generators can't co_await.
+    template <typename U>
+    std::suspend_never await_transform(U&&) = delete;
+
+  private:
+    friend class generator;
+
+    // The value that was yielded last. Only set in the promise of the outermost generator.
+    const T* m_value{};
+
+    // The outermost generator, and the innermost one that is currently running (only set in the outermost).
+    promise_type* m_root{this};
+    handle_t      m_leaf{handle_t::from_promise(*this)};
+
+    // The generator that yielded this one.
+    handle_t           m_parent{};
+    std::exception_ptr m_exception;
+  };
+
+  generator(generator&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, {}))
+      , m_started(other.m_started) {
+  }
+
+  generator& operator=(generator&& other) noexcept {
+    if (this != &other) {
+      if (m_handle) {
+        m_handle.destroy();
+      }
+
+      m_handle  = std::exchange(other.m_handle, {});
+      m_started = other.m_started;
+    }
+
+    return *this;
+  }
+
+  generator(const generator&) = delete;
+
+  generator& operator=(const generator&) = delete;
+
+  ~generator() {
+    if (m_handle) {
+      m_handle.destroy();
+    }
+  }
+
+private:
+  template <typename>
+  friend class details::coroutine_range;
+
+  explicit generator(handle_t handle)
+      : m_handle(handle) {
+  }
+
+  // Runs the coroutine up to its first co_yield, unless that already happened.
+  void start() {
+    if (!m_started && m_handle) {
+      m_started = true;
+      resume();
+    }
+  }
+
+  void resume() {
+    m_handle.promise().m_leaf.resume();
+  }
+
+  bool done() const {
+    return !m_handle || m_handle.done();
+  }
+
+  const T& value() const {
+    return *m_handle.promise().m_value;
+  }
+
+  handle_t m_handle{};
+  bool     m_started{};
+};
+#endif
+
+namespace details {
+// ----------------------------------
+// Range declarations
+// ----------------------------------
+
+template <typename TPrevRange, typename TPredicate>
+class where_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class distinct_range;
+
+template <typename TPrevRange, typename TTransform>
+class select_range;
+
+template <typename TPrevRange>
+class select_to_string_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class select_to_string_view_range;
+
+template <typename TPrevRange, typename TTransform>
+class select_many_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class reverse_range;
+
+template <typename TPrevRange>
+class take_range;
+
+template <typename TPrevRange, typename TPredicate>
+class take_while_range;
+
+template <typename TPrevRange>
+class skip_range;
+
+template <typename TPrevRange, typename TPredicate>
+class skip_while_range;
+
+template <typename TPrevRange, typename TOtherRange>
+class append_range;
+
+template <typename TPrevRange>
+class repeat_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class chunk_range;
+
+template <typename TTransform, typename... TRanges>
+class zip_range;
+
+template <typename TPrevRange, typename TOperation, typename TAccum, bool Inclusive>
+class scan_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class window_range;
+
+template <typename TPrevRange, typename TAggregator, typename TAllocator = std::allocator<std::byte>>
+class window_aggregate_range;
+
+template <typename TPrevRange, typename TAllocator = std::allocator<std::byte>>
+class tee_range;
+
+template <typename TPrevRange,
+          typename TOtherRange,
+          typename TKeySelectorA,
+          typename TKeySelectorB,
+          typename TTransform>
+class join_range;
+
+template <typename TPrevRange, typename TKeySelector, typename TAllocator = std::allocator<std::byte>>
+class order_by_range;
+
+template <typename TPrevRange, typename TKeySelector>
+class then_by_range;
+
+template <typename TContainer, typename TFirstBound, typename TLastBound>
+class key_range;
+
+// ----------------------------------
+// Average calculators
+// ----------------------------------
+
+#ifdef __cpp_lib_concepts
+template <typename T>
+concept number = std::integral<T> || std::floating_point<T>;
+
+template <typename T>
+concept averageable = requires(T a, T b, size_t c) {
+  { a / c } -> std::same_as<T>;
+  a += b;
+};
+
+template <typename T>
+concept addable = requires(T a, T b) {
+  std::is_convertible_v<int, T>;
+  a += b;
+  a < b;
+};
+#endif
+
+template <typename T, typename TSumAndCount>
+#ifdef __cpp_lib_concepts
+  requires(averageable<T> || number<T>)
+#endif
+static auto calculate_average(const TSumAndCount& maybe_sum_and_count) {
+  using float_type = long double;
+  using output_t   = T;
+
+#ifdef __cpp_lib_concepts
+  using return_t = std::conditional_t<number<output_t>, float_type, output_t>;
+#else
+  using return_t =
+      std::conditional_t<std::is_integral<output_t>::value || std::is_floating_point_v<output_t>, float_type, output_t>;
+#endif
+
+  if (maybe_sum_and_count) {
+    const auto& sum_and_count = *maybe_sum_and_count;
+    return std::optional<return_t>{static_cast<return_t>(sum_and_count.first) / sum_and_count.second};
+  }
+
+  return std::optional<return_t>{};
+}
+
+// ----------------------------------
+// Allocators
+// ----------------------------------
+
+/*
+ * Operators that buffer elements (distinct, reverse, order_by, then_by, chunk, window,
+ * window_aggregate, tee, select_to_string_view), the parallel operators and terminals that
+ * produce containers accept an optional allocator. It is rebound to whatever the operator stores,
+ * so any allocator type works, e.g. std::pmr::polymorphic_allocator<std::byte>.
+ */
+
+template <typename TAllocator, typename T>
+using rebind_alloc_t = typename std::allocator_traits<TAllocator>::template rebind_alloc<T>;
+
+// A buffer that a range rebuilds every time it's iterated. Since its contents are temporary, a copy
+// starts out empty. It does keep the allocator though, whereas copying a container
+// would ask the allocator for a copy of itself (which for polymorphic allocators
+// means falling back to the default memory resource).
+template <typename T, typename TAllocator>
+class scratch_buffer {
+public:
+  using container_t = std::vector<T, rebind_alloc_t<TAllocator, T>>;
+
+  explicit scratch_buffer(const TAllocator& allocator = TAllocator())
+      : m_values(rebind_alloc_t<TAllocator, T>(allocator)) {
+  }
+
+  scratch_buffer(const scratch_buffer& copy_from)
+      : m_values(copy_from.m_values.get_allocator()) {
+  }
+
+  scratch_buffer& operator=(const scratch_buffer&) {
+    m_values.clear();
+    return *this;
+  }
+
+  container_t& values() {
+    return m_values;
+  }
+
+  const container_t& values() const {
+    return m_values;
+  }
+
+  TAllocator get_allocator() const {
+    return TAllocator(m_values.get_allocator());
+  }
+
+private:
+  container_t m_values;
+};
+
+// ----------------------------------
+// Output containers
+// ----------------------------------
+
+template <typename TContainer, typename = void>
+inline constexpr bool has_reserve_v = false;
+
+template <typename TContainer>
+inline constexpr bool
+    has_reserve_v<TContainer, std::void_t<decltype(std::declval<TContainer&>().reserve(size_t{}))>> = true;
+
+template <typename TContainer, typename = void>
+inline constexpr bool has_capacity_v = false;
+
+template <typename TContainer>
+inline constexpr bool
+    has_capacity_v<TContainer, std::void_t<decltype(std::declval<const TContainer&>().capacity())>> = true;
+
+template <typename TContainer, typename = void>
+inline constexpr bool has_load_factor_v = false;
+
+template <typename TContainer>
+inline constexpr bool has_load_factor_v<TContainer,
+                                        std::void_t<decltype(std::declval<const TContainer&>().bucket_count() *
+                                                             std::declval<const TContainer&>().max_load_factor())>> =
+    true;
+
+// Reserves room for count more elements, if the container supports it. Like push_back, this grows the
+// capacity geometrically, so that appending to the same container repeatedly stays linear.
+template <typename TContainer>
+void reserve_additional(TContainer& container, size_t count) {
+  if constexpr (has_reserve_v<TContainer> && (has_capacity_v<TContainer> || has_load_factor_v<TContainer>)) {
+    size_t capacity = 0;
+
+    if constexpr (has_capacity_v<TContainer>) {
+      capacity = static_cast<size_t>(container.capacity());
+    }
+    else {
+      capacity = static_cast<size_t>(static_cast<float>(container.bucket_count()) * container.max_load_factor());
+    }
+
+    const size_t required = container.size() + count;
+
+    if (capacity < required) {
+      container.reserve(std::max(required, 2 * capacity));
+    }
+  }
+}
+
+template <typename TContainer, typename TValue, typename = void>
+inline constexpr bool has_emplace_back_v = false;
+
+template <typename TContainer, typename TValue>
+inline constexpr bool has_emplace_back_v<
+    TContainer,
+    TValue,
+    std::void_t<decltype(std::declval<TContainer&>().emplace_back(std::declval<TValue>()))>> = true;
+
+template <typename TContainer, typename TValue, typename = void>
+inline constexpr bool has_emplace_hint_v = false;
+
+template <typename TContainer, typename TValue>
+inline constexpr bool has_emplace_hint_v<
+    TContainer,
+    TValue,
+    std::void_t<decltype(std::declval<TContainer&>().emplace_hint(std::declval<TContainer&>().end(),
+                                                                  std::declval<TValue>()))>> = true;
+
+// Appends a value to the end of a sequence container (std::vector, std::deque, std::list, ...),
+// or inserts it into an associative container (std::set, std::map, flat containers, ...).
+// Since elements usually arrive in order, the end is passed as a hint to ordered containers.
+template <typename TContainer, typename TValue>
+void append_element(TContainer& container, TValue&& value) {
+  if constexpr (has_emplace_back_v<TContainer, TValue>) {
+    container.emplace_back(std::forward<TValue>(value));
+  }
+  else if constexpr (has_emplace_hint_v<TContainer, TValue>) {
+    container.emplace_hint(container.end(), std::forward<TValue>(value));
+  }
+  else {
+    container.insert(container.end(), std::forward<TValue>(value));
+  }
+}
+
+// ----------------------------------
+// Parallel algorithms
+// ----------------------------------
+
+// Determines whether an iterator type supports constant-time jumps.
+template <typename TIter>
+inline constexpr bool is_random_access_iterator_v =
+    std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<TIter>::iterator_category>;
+
+// Determines whether a container stores its elements contiguously, i.e. provides data().
+template <typename TContainer, typename = void>
+inline constexpr bool is_contiguous_container_v = false;
+
+template <typename TContainer>
+inline constexpr bool
+    is_contiguous_container_v<TContainer, std::void_t<decltype(std::declval<const TContainer&>().data())>> =
+        std::is_pointer_v<decltype(std::declval<const TContainer&>().data())>;
+
+// Determines whether a container is associative, i.e. provides key lookups such as std::set or std::unordered_map.
+template <typename TContainer, typename = void>
+inline constexpr bool is_associative_container_v = false;
+
+template <typename TContainer>
+inline constexpr bool is_associative_container_v<
+    TContainer,
+    std::void_t<decltype(std::declval<const TContainer&>().equal_range(
+        std::declval<const typename TContainer::key_type&>()))>> = true;
+
+// Determines whether a type is a pair, e.g. the elements of maps.
+template <typename T, typename = void>
+inline constexpr bool is_pair_like_v = false;
+
+template <typename T>
+inline constexpr bool
+    is_pair_like_v<T,
+                   std::void_t<decltype(std::declval<const T&>().first), decltype(std::declval<const T&>().second)>> =
+        true;
+
+// The key of an element for find_key(): the first member of pairs, otherwise the element itself.
+template <typename T>
+const auto& element_key(const T& element) {
+  if constexpr (is_pair_like_v<T>) {
+    return element.first;
+  }
+  else {
+    return element;
+  }
+}
+
+// Compares an element with a value for contains(). Pairs are compared member by member, so that
+// the pair<const K, V> of a map can be compared with a pair<K, V>.
+template <typename TElement, typename TValue>
+bool element_equals(const TElement& element, const TValue& value) {
+  if constexpr (is_pair_like_v<TElement> && is_pair_like_v<TValue>) {
+    return element.first == value.first && element.second == value.second;
+  }
+  else {
+    return element == value;
+  }
+}
+
+// Determines whether a container is a hash container with a bucket interface, e.g. std::unordered_map.
+template <typename TContainer, typename = void>
+inline constexpr bool is_bucketed_container_v = false;
+
+template <typename TContainer>
+inline constexpr bool is_bucketed_container_v<TContainer,
+                                              std::void_t<typename TContainer::const_local_iterator,
+                                                          decltype(std::declval<const TContainer&>().bucket_count())>> =
+    true;
+
+// Determines whether a type satisfies the executor requirements (see linq::executor).
+template <typename T, typename = void>
+struct is_executor : std::false_type {};
+
+template <typename T>
+struct is_executor<T,
+                   std::void_t<decltype(static_cast<size_t>(std::declval<T&>().concurrency())),
+                               decltype(std::declval<T&>().bulk(size_t{}, std::declval<void (*)(size_t)>()))>>
+    : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_executor_v = is_executor<std::remove_reference_t<T>>::value;
+
+/**
+ * @brief A non-owning, type-erased reference to an executor.
+ * Used by ranges that have to store the executor they were created with.
+ */
+class executor_ref {
+public:
+  template <typename TExecutor>
+  explicit executor_ref(TExecutor& executor)
+      : m_executor(const_cast<void*>(static_cast<const void*>(std::addressof(executor))))
+      , m_concurrency([](void* e) { return static_cast<size_t>(static_cast<TExecutor*>(e)->concurrency()); })
+      , m_bulk([](void* e, size_t task_count, const void* func, void (*invoke)(const void*, size_t)) {
+        static_cast<TExecutor*>(e)->bulk(task_count, [func, invoke](size_t index) { invoke(func, index); });
+      }) {
+  }
+
+  size_t concurrency() const {
+    return m_concurrency(m_executor);
+  }
+
+  template <typename TFunc>
+  void bulk(size_t task_count, const TFunc& func) const {
+    m_bulk(m_executor, task_count, std::addressof(func), [](const void* f, size_t index) {
+      (*static_cast<const TFunc*>(f))(index);
+    });
+  }
+
+private:
+  void* m_executor;
+  size_t (*m_concurrency)(void*);
+  void (*m_bulk)(void*, size_t, const void*, void (*)(const void*, size_t));
+};
+
+// The maximum number of source elements that a parallel task claims at once.
+// Small morsels keep all threads busy when the cost per element is skewed.
+inline constexpr size_t max_morsel_size = 2048;
+
+/**
+ * @brief Splits [0, count) into morsels of morsel_size elements and hands them out to the tasks
+ * of a bulk operation on demand. Calls func(first, last, slot) for every morsel, where slot
+ * identifies the task that processes the morsel and is less than executor.concurrency().
+ */
+template <typename TExecutor, typename TFunc>
+void for_each_morsel(TExecutor& executor, size_t count, size_t morsel_size, const TFunc& func) {
+  const size_t slot_count = std::max(static_cast<size_t>(executor.concurrency()), size_t{1});
+  const size_t task_count = std::min(slot_count, (count + morsel_size - 1) / morsel_size);
+
+  std::atomic<size_t> next{0};
+
+  executor.bulk(task_count, [&](size_t slot) {
+    for (;;) {
+      const size_t first = next.fetch_add(morsel_size, std::memory_order_relaxed);
+
+      if (first >= count) {
+        break;
+      }
+
+      func(first, std::min(first + morsel_size, count), slot);
+    }
+  });
+}
+
+// Same as above, but picks a morsel size that suits the executor.
+template <typename TExecutor, typename TFunc>
+void for_each_morsel(TExecutor& executor, size_t count, const TFunc& func) {
+  const size_t slot_count  = std::max(static_cast<size_t>(executor.concurrency()), size_t{1});
+  const size_t morsel_size = std::clamp(count / (slot_count * 8), size_t{1}, max_morsel_size);
+
+  for_each_morsel(executor, count, morsel_size, func);
+}
+
+// Keeps per-task partial results on separate cache lines.
+template <typename T>
+struct alignas(64) parallel_partial {
+  std::optional<T> value;
+};
+
+/**
+ * @brief Folds a sliceable range in parallel.
+ * Every task folds the elements of its morsels into its own partial result using
+ * accumulate(std::optional<TResult>&, element). The partial results are then folded
+ * using combine(TResult&, TResult&&). The partial results are allocated from allocator.
+ */
+template <typename TResult,
+          typename TExecutor,
+          typename TRange,
+          typename TAccumulate,
+          typename TCombine,
+          typename TAllocator>
+std::optional<TResult> parallel_fold(TExecutor&         executor,
+                                     const TRange&      range,
+                                     const TAccumulate& accumulate,
+                                     const TCombine&    combine,
+                                     const TAllocator&  allocator) {
+  using partial_t = parallel_partial<TResult>;
+
+  std::vector<partial_t, rebind_alloc_t<TAllocator, partial_t>> partials(
+      std::max(static_cast<size_t>(executor.concurrency()), size_t{1}),
+      rebind_alloc_t<TAllocator, partial_t>(allocator));
+
+  for_each_morsel(executor, range.slice_count(), [&](size_t first, size_t last, size_t slot) {
+    auto& partial     = partials[slot].value;
+    auto [begin, end] = range.slice(first, last);
+
+    for (; begin != end; ++begin) {
+      accumulate(partial, *begin);
+    }
+  });
+
+  std::optional<TResult> result;
+
+  for (auto& partial : partials) {
+    if (!partial.value) {
+      continue;
+    }
+
+    if (result) {
+      combine(*result, std::move(*partial.value));
+    }
+    else {
+      result = std::move(partial.value);
+    }
+  }
+
+  return result;
+}
+
+// The number of source elements per leaf of the reduction tree of reproducible reductions.
+inline constexpr size_t reproducible_block_size = 1024;
+
+/**
+ * @brief Folds a sliceable range in parallel with a result that doesn't depend on the executor.
+ * The source is split into fixed blocks of reproducible_block_size elements, each block is folded
+ * from left to right and the block results are combined in a fixed pairwise tree. The shape of
+ * the computation therefore only depends on the number of source elements, which makes floating-point
+ * results bit-identical regardless of thread count and scheduling. The block results are allocated
+ * from allocator.
+ */
+template <typename TResult,
+          typename TExecutor,
+          typename TRange,
+          typename TAccumulate,
+          typename TCombine,
+          typename TAllocator>
+std::optional<TResult> parallel_tree_fold(TExecutor&         executor,
+                                          const TRange&      range,
+                                          const TAccumulate& accumulate,
+                                          const TCombine&    combine,
+                                          const TAllocator&  allocator) {
+  using block_t = std::optional<TResult>;
+
+  const size_t count       = range.slice_count();
+  const size_t block_count = (count + reproducible_block_size - 1) / reproducible_block_size;
+
+  std::vector<block_t, rebind_alloc_t<TAllocator, block_t>> blocks(block_count,
+                                                                   rebind_alloc_t<TAllocator, block_t>(allocator));
+
+  for_each_morsel(executor, count, reproducible_block_size, [&](size_t first, size_t last, size_t) {
+    auto& block       = blocks[first / reproducible_block_size];
+    auto [begin, end] = range.slice(first, last);
+
+    for (; begin != end; ++begin) {
+      accumulate(block, *begin);
+    }
+  });
+
+  for (size_t width = 1; width < block_count; width *= 2) {
+    for (size_t i = 0; i + width < block_count; i += 2 * width) {
+      auto& left  = blocks[i];
+      auto& right = blocks[i + width];
+
+      if (!right) {
+        continue;
+      }
+
+      if (left) {
+        combine(*left, std::move(*right));
+      }
+      else {
+        left = std::move(right);
+      }
+    }
+  }
+
+  return block_count == 0 ? std::optional<TResult>{} : std::move(blocks.front());
+}
+
+/**
+ * @brief Computes the prefix sums of an indexed range in two parallel passes.
+ * The elements are split into blocks. The first pass folds every block, after which the offset
+ * of each block is computed from the folds of the blocks before it. The second pass scans every
+ * block starting from its offset. For exclusive scans, init is the offset of the first block.
+ */
+template <typename TAccum,
+          bool Inclusive,
+          typename TExecutor,
+          typename TRange,
+          typename TOperation,
+          typename TAllocator>
+std::vector<TAccum, rebind_alloc_t<TAllocator, TAccum>> parallel_indexed_scan(TExecutor&            executor,
+                                                                              const TRange&         range,
+                                                                              const TOperation&     operation,
+                                                                              std::optional<TAccum> init,
+                                                                              const TAllocator&     allocator) {
+  constexpr size_t min_block_size = 1024;
+
+  const size_t count       = range.slice_count();
+  const size_t slot_count  = std::max(static_cast<size_t>(executor.concurrency()), size_t{1});
+  const size_t block_size  = std::max(count / (slot_count * 4), min_block_size);
+  const size_t block_count = (count + block_size - 1) / block_size;
+
+  std::vector<std::optional<TAccum>, rebind_alloc_t<TAllocator, std::optional<TAccum>>> offsets(
+      block_count + 1, rebind_alloc_t<TAllocator, std::optional<TAccum>>(allocator));
+  std::vector<TAccum, rebind_alloc_t<TAllocator, TAccum>> result(count, rebind_alloc_t<TAllocator, TAccum>(allocator));
+
+  // First pass: fold every block except the last one, whose fold isn't needed.
+  executor.bulk(block_count > 0 ? block_count - 1 : 0, [&](size_t block) {
+    auto&        fold  = offsets[block + 1];
+    const size_t first = block * block_size;
+
+    fold.emplace(range.at(first));
+
+    for (size_t i = first + 1; i < first + block_size; ++i) {
+      fold.emplace(operation(*fold, range.at(i)));
+    }
+  });
+
+  offsets[0] = std::move(init);
+
+  for (size_t block = 1; block < block_count; ++block) {
+    if (offsets[block - 1]) {
+      offsets[block].emplace(operation(*offsets[block - 1], *offsets[block]));
+    }
+  }
+
+  // Second pass: scan every block, starting from its offset.
+  executor.bulk(block_count, [&](size_t block) {
+    std::optional<TAccum> value = offsets[block];
+    const size_t          first = block * block_size;
+    const size_t          last  = std::min(first + block_size, count);
+
+    for (size_t i = first; i < last; ++i) {
+      if constexpr (Inclusive) {
+        if (value) {
+          value.emplace(operation(*value, range.at(i)));
+        }
+        else {
+          value.emplace(range.at(i));
+        }
+
+        result[i] = *value;
+      }
+      else {
+        result[i] = *value;
+        value.emplace(operation(*value, range.at(i)));
+      }
+    }
+  });
+
+  return result;
+}
+
+// The length of the runs that stable sorts sort by insertion before merging them.
+inline constexpr size_t stable_sort_run_size = 32;
+
+// Sorts every run of stable_sort_run_size elements of [first, last) by insertion.
+template <typename TIter, typename TCompare>
+void sort_runs(TIter first, TIter last, const TCompare& compare) {
+  for (auto run_begin = first; run_begin != last;) {
+    const auto run_end = last - run_begin > static_cast<std::ptrdiff_t>(stable_sort_run_size)
+                             ? run_begin + static_cast<std::ptrdiff_t>(stable_sort_run_size)
+                             : last;
+
+    for (auto it = run_begin + 1; it < run_end; ++it) {
+      std::rotate(std::upper_bound(run_begin, it, *it, compare), it, it + 1);
+    }
+
+    run_begin = run_end;
+  }
+}
+
+// Merges the sorted runs of [first, last) in rounds of doubling width, alternating between buffer and
+// [first, last). buffer has to hold the elements of [first, last) (e.g. moved there); the result ends
+// up in [first, last).
+template <typename TIter, typename TCompare>
+void merge_runs(TIter first, TIter last, TIter buffer, const TCompare& compare) {
+  const size_t count = static_cast<size_t>(last - first);
+  const auto   at    = [](TIter it, size_t index) { return it + static_cast<std::ptrdiff_t>(index); };
+
+  TIter from = buffer;
+  TIter to   = first;
+
+  for (size_t width = stable_sort_run_size; width < count; width *= 2) {
+    for (size_t lo = 0; lo < count; lo += 2 * width) {
+      const size_t mid = std::min(lo + width, count);
+      const size_t hi  = std::min(lo + 2 * width, count);
+
+      std::merge(std::make_move_iterator(at(from, lo)),
+                 std::make_move_iterator(at(from, mid)),
+                 std::make_move_iterator(at(from, mid)),
+                 std::make_move_iterator(at(from, hi)),
+                 at(to, lo),
+                 compare);
+    }
+
+    std::swap(from, to);
+  }
+
+  if (from != first) {
+    std::move(buffer, at(buffer, count), first);
+  }
+}
+
+/**
+ * @brief Sorts values stably, using buffer as scratch memory.
+ * Unlike std::stable_sort, which takes a temporary buffer from the global heap on every call,
+ * this uses a buffer that is owned by the caller, so it keeps its capacity across sorts and
+ * is allocated with the allocator of the caller.
+ * Short runs are sorted by insertion and then merged in rounds of doubling width, alternating
+ * between buffer and values.
+ */
+template <typename TVector, typename TCompare>
+void buffered_stable_sort(TVector& values, TVector& buffer, const TCompare& compare) {
+  sort_runs(values.begin(), values.end(), compare);
+
+  if (values.size() <= stable_sort_run_size) {
+    return;
+  }
+
+  buffer.assign(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+  merge_runs(values.begin(), values.end(), buffer.begin(), compare);
+  buffer.clear();
+}
+
+/**
+ * @brief Sorts values stably in parallel, using buffer as scratch memory (see buffered_stable_sort).
+ * Contiguous chunks are sorted by the tasks of the executor and then merged pairwise in rounds.
+ * The buffer is only resized on the calling thread; the tasks merge into its existing elements.
+ */
+template <typename TExecutor, typename TVector, typename TCompare>
+void parallel_stable_sort(TExecutor& executor, TVector& values, TVector& buffer, const TCompare& compare) {
+  constexpr size_t min_chunk_size = 4096;
+
+  const size_t count       = values.size();
+  const size_t chunk_count = std::min(static_cast<size_t>(executor.concurrency()), count / min_chunk_size);
+
+  if (chunk_count < 2) {
+    buffered_stable_sort(values, buffer, compare);
+    return;
+  }
+
+  const size_t chunk_size  = count / chunk_count;
+  const auto   chunk_begin = [&](TVector& vector, size_t i) {
+    return vector.begin() + static_cast<std::ptrdiff_t>(i >= chunk_count ? count : i * chunk_size);
+  };
+
+  executor.bulk(chunk_count,
+                [&](size_t i) { sort_runs(chunk_begin(values, i), chunk_begin(values, i + 1), compare); });
+
+  buffer.assign(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+
+  executor.bulk(chunk_count, [&](size_t i) {
+    merge_runs(chunk_begin(values, i), chunk_begin(values, i + 1), chunk_begin(buffer, i), compare);
+  });
+
+  TVector* from = &values;
+  TVector* to   = &buffer;
+
+  for (size_t width = 1; width < chunk_count; width *= 2) {
+    const size_t merge_count = (chunk_count + 2 * width - 1) / (2 * width);
+
+    executor.bulk(merge_count, [&](size_t i) {
+      const size_t lo  = i * 2 * width;
+      const size_t mid = std::min(lo + width, chunk_count);
+      const size_t hi  = std::min(lo + 2 * width, chunk_count);
+
+      // A chunk without a partner is moved over as well.
+      std::merge(std::make_move_iterator(chunk_begin(*from, lo)),
+                 std::make_move_iterator(chunk_begin(*from, mid)),
+                 std::make_move_iterator(chunk_begin(*from, mid)),
+                 std::make_move_iterator(chunk_begin(*from, hi)),
+                 chunk_begin(*to, lo),
+                 compare);
+    });
+
+    std::swap(from, to);
+  }
+
+  if (from != &values) {
+    executor.bulk(chunk_count, [&](size_t i) {
+      std::move(chunk_begin(buffer, i), chunk_begin(buffer, i + 1), chunk_begin(values, i));
+    });
+  }
+
+  buffer.clear();
+}
+
+// ----------------------------------
+// base_range
+// ----------------------------------
+
+// Base class to identify all range types (for compile-time type checking).
+class base_range_ident {
+  /* Nothing to define here. */
+};
+
+// Base class for sorting ranges (for compile-time type checking).
+class sorting_range {
+  /* Nothing to define here. */
+};
+
+/**
+ * @brief Represents the base class of all LINQ ranges.
+ * @tparam TOutput The full, unmodified type that is returned by the range.
+ */
+template <typename TMy, typename TOutput>
+class base_range : public base_range_ident {
+public:
+  // Return non-const, non-volatile, non-reference types from methods such as sum, min and max.
+  using output_t = std::decay_t<TOutput>;
+
+  // Whether the range can be split into independent slices of its source, which is what
+  // parallel operators require. Sliceable ranges provide slice_count() and slice(first, last).
+  static constexpr bool is_sliceable = false;
+
+  // Whether the range yields the elements of contiguous storage, in order.
+  // Contiguous ranges are also sliceable and provide data().
+  static constexpr bool is_contiguous = false;
+
+  // Whether every element of the range can be computed from its index alone.
+  // Indexed ranges are also sliceable, with slice_count() being the number of elements,
+  // and provide at(index).
+  static constexpr bool is_indexed = false;
+
+  // Whether the range stores its elements itself, e.g. a copied container or a sort buffer.
+  // Such ranges provide owned_elements(), which returns the container of the elements in
+  // iteration order. Consuming terminals on rvalue ranges move the elements out of it.
+  static constexpr bool owns_elements = false;
+
+  // Whether the elements are stored by the range or by a range it's built on, e.g. the sort buffer of
+  // order_by or the inline storage of from({...}). References to them dangle once the range is destroyed.
+  static constexpr bool holds_elements = false;
+
+  // Whether the range yields the unfiltered elements of an associative container such as std::set
+  // or std::unordered_map. Such ranges provide container(), whose lookups contains() and find_key() use.
+  static constexpr bool is_associative = false;
+
+  // Whether the range is an ascending arithmetic sequence of integers such as from_to(0, 10).
+  // Such ranges are also indexed and provide sequence_sum(), the closed form of sum().
+  static constexpr bool is_arithmetic_sequence = false;
+
+  /**
+   * @brief Appends a filter to the range.
+   * @tparam TPredicate The type of the predicate: f(x) -> bool
+   * @param predicate The predicate
+   * @return A new range that combines this range with the where-range.
+   */
+  template <typename TPredicate>
+  [[nodiscard]] auto where(TPredicate&& predicate) const;
+
+  /**
+   * @brief Appends a distinct-filter to the range that removes duplicate elements.
+   * @return A new range that combines this range with the distinct-range.
+   */
+  [[nodiscard]] auto distinct() const;
+
+  /**
+   * @brief Same as distinct(), but allocates its buffer from an allocator (see "Allocators").
+   */
+  template <typename TAllocator>
+  [[nodiscard]] auto distinct(const TAllocator& allocator) const;
+
+  template <typename TTransform>
+  [[nodiscard]] auto select(TTransform&& transform) const;
+
+  /**
+   * @brief Same as select(), for a transform that returns a reference into the element it's given,
+   * e.g. [](const Person& p) -> const std::string& { return p.name; }.
+   * The resulting range yields these references instead of copies, and so do the filtering, sorting and
+   * partitioning operators that follow it. This range's elements have to be references as well.
+   */
+  template <typename TTransform>
+  [[nodiscard]] auto select_ref(TTransform&& transform) const;
+
+  /**
+   * @brief Yields a reference to a data member of every element, e.g. select_member(&Person::name).
+   * See select_ref().
+   */
+  template <typename TClass, typename TMember>
+  [[nodiscard]] auto select_member(TMember TClass::*member) const;
+
+  [[nodiscard]] auto select_to_string() const;
+
+  /**
+   * @brief Formats every element into a buffer that's owned by the iterator, using std::to_chars, and
+   * yields a formatted_text that converts to a std::string_view of it. The text is valid until the iterator
+   * is incremented, so it can only be consumed while streaming (loops, where, select, string_join, ...);
+   * use select_to_string to keep it. An element is formatted at most once, regardless of how often it's
+   * dereferenced. Stored strings and string views are passed through as std::string_view.
+   * @param format How to format floating-point numbers
+   */
+  [[nodiscard]] auto select_to_string_view(float_format format = {}) const;
+
+  /**
+   * @brief Same as select_to_string_view(format), but allocates the text that doesn't fit into the
+   * iterator (copied strings and very long numbers) from an allocator (see "Allocators").
+   * Every iterator allocates its own text, so with an execution_context the range must not be
+   * consumed by the parallel operators.
+   */
+  template <typename TAllocator>
+  [[nodiscard]] auto select_to_string_view(float_format format, const TAllocator& allocator) const;
+
+  template <typename TTransform>
+  [[nodiscard]] auto select_many(TTransform&& transform) const;
+
+  [[nodiscard]] auto reverse() const;
+
+  /**
+   * @brief Same as reverse(), but allocates its buffer from an allocator (see "Allocators").
+   */
+  template <typename TAllocator>
+  [[nodiscard]] auto reverse(const TAllocator& allocator) const;
+
+  [[nodiscard]] auto take(size_t count) const;
+
+  template <typename TPredicate>
+  [[nodiscard]] auto take_while(TPredicate&& predicate) const;
+
+  [[nodiscard]] auto skip(size_t count) const;
+
+  template <typename TPredicate>
+  [[nodiscard]] auto skip_while(TPredicate&& predicate) const;
+
+  template <typename TOtherRange>
+  [[nodiscard]] auto append(const TOtherRange& other_range) const;
+
+  [[nodiscard]] auto repeat(size_t count) const;
+
+  /**
+   * @brief Groups consecutive elements into chunks of up to size elements each.
+   * Every chunk is a chunk_view. If the range is contiguous (see is_contiguous), the chunks
+   * view the source directly. Otherwise, the elements are copied into a buffer that is reused
+   * for every chunk, so that a chunk is only valid until the iterator is incremented.
+   * @throws std::invalid_argument if size is zero
+   */
+  [[nodiscard]] auto chunk(size_t size) const;
+
+  /**
+   * @brief Same as chunk(size), but allocates the chunk buffer from an allocator (see "Allocators").
+   */
+  template <typename TAllocator>
+  [[nodiscard]] auto chunk(size_t size, const TAllocator& allocator) const;
+
+  /**
+   * @brief Walks this range and other ranges in lockstep, yielding a std::tuple of their elements.
+   * The resulting range ends as soon as any of the ranges ends. The tuple holds references to elements
+   * that live outside the ranges, and copies of elements that are stored by a range (see holds_elements).
+   */
+  template <typename... TOtherRanges>
+  [[nodiscard]] auto zip(const TOtherRanges&... other_ranges) const;
+
+  /**
+   * @brief Walks this range and another range in lockstep, yielding transform(a, b).
+   * If both ranges are indexed (e.g. containers with random access), elements are computed
+   * by index instead of stepping iterators, which allows compilers to vectorize loops over
+   * element-wise arithmetic.
+   */
+  template <typename TOtherRange, typename TTransform>
+  [[nodiscard]] auto zip_with(const TOtherRange& other_range, TTransform&& transform) const;
+
+  /**
+   * @brief Yields the running results of folding the range with an operation (inclusive prefix sum).
+   * The first element is yielded as is, every following element is operation(previous_result, element).
+   * The running result lives in the iterator, so the range can be iterated any number of times.
+   */
+  template <typename TOperation>
+  [[nodiscard]] auto scan(TOperation&& operation) const;
+
+  /**
+   * @brief Same as scan, but starts with init and yields the running result before each element
+   * is folded in (exclusive prefix sum). The resulting range has as many elements as this range.
+   */
+  template <typename TInit, typename TOperation>
+  [[nodiscard]] auto exclusive_scan(TInit init, TOperation&& operation) const;
+
+  /**
+   * @brief Yields every window of size consecutive elements as a chunk_view, sliding by one element.
+   * A range of n elements yields n - size + 1 windows, or none if it has less than size elements.
+   * If the range is contiguous (see is_contiguous), the windows view the source directly. Otherwise,
+   * the elements are buffered and a window is only valid until the iterator is incremented.
+   * @throws std::invalid_argument if size is zero
+   */
+  [[nodiscard]] auto window(size_t size) const;
+
+  /**
+   * @brief Same as window(size), but allocates the window buffer from an allocator (see "Allocators").
+   */
+  template <typename TAllocator>
+  [[nodiscard]] auto window(size_t size, const TAllocator& allocator) const;
+
+  /**
+   * @brief Yields an aggregate of every window of size consecutive elements, sliding by one element.
+   * Every element enters and leaves the aggregation exactly once, so the cost is linear in the
+   * number of elements, independent of the window size.
+   * @param aggregation linq::rolling_sum, linq::rolling_average, linq::rolling_min, linq::rolling_max
+   * or a custom aggregation (see "Window aggregations")
+   * @throws std::invalid_argument if size is zero
+   */
+  template <typename TAggregation>
+  [[nodiscard]] auto window_aggregate(size_t size, TAggregation aggregation) const {
+    return window_aggregate(size, std::move(aggregation), std::allocator<std::byte>());
+  }
+
+  /**
+   * @brief Same as window_aggregate(size, aggregation), but allocates the window buffer and the
+   * state of linq::rolling_min and linq::rolling_max from an allocator (see "Allocators").
+   */
+  template <typename TAggregation, typename TAllocator>
+  [[nodiscard]] auto window_aggregate(size_t size, TAggregation aggregation, const TAllocator& allocator) const;
+
+  /**
+   * @brief Splits the range into Count ranges that share a single evaluation of it.
+   * Every element is computed once, no matter how many of the returned ranges consume it.
+   * Elements are buffered until the last consumer has moved past them, so consumers that are
+   * iterated in lockstep (e.g. zipped together) need almost no buffer.
+   * The returned ranges are single-pass: each of them can be iterated once, and they must not
+   * be consumed from multiple threads.
+   *
+   * Example:
+   * @code{.cpp}
+   * auto [a, b] = linq::from(&rows).select(parse).tee<2>();
+   * auto total  = a.sum();  // parses every row once
+   * auto top    = b.max();  // reads the buffered results
+   * @endcode
+   */
+  template <size_t Count>
+  [[nodiscard]] auto tee() const;
+
+  /**
+   * @brief Same as tee<Count>(), but allocates the shared state and its buffer from an allocator
+   * (see "Allocators").
+   */
+  template <size_t Count, typename TAllocator>
+  [[nodiscard]] auto tee(const TAllocator& allocator) const;
+
+  template <typename TOtherRange, typename TKeySelectorA, typename TKeySelectorB, typename TTransform>
+  [[nodiscard]] auto join(const TOtherRange& other_range,
+                          TKeySelectorA&&    key_selector_a,
+                          TKeySelectorB&&    key_selector_b,
+                          TTransform&&       transform) const;
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto order_by(TKeySelector&& key_selector, sort_direction sort_dir) const;
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto order_by_ascending(TKeySelector&& key_selector) const {
+    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending);
+  }
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto order_by_descending(TKeySelector&& key_selector) const {
+    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending);
+  }
+
+  /**
+   * @brief Same as order_by(key_selector, sort_dir), but allocates the sort buffer from an allocator
+   * (see "Allocators"). Subsequent then_by operations use the same allocator.
+   */
+  template <typename TKeySelector, typename TAllocator>
+  [[nodiscard]] auto order_by(TKeySelector&& key_selector, sort_direction sort_dir, const TAllocator& allocator) const;
+
+  template <typename TKeySelector, typename TAllocator>
+  [[nodiscard]] auto order_by_ascending(TKeySelector&& key_selector, const TAllocator& allocator) const {
+    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending, allocator);
+  }
+
+  template <typename TKeySelector, typename TAllocator>
+  [[nodiscard]] auto order_by_descending(TKeySelector&& key_selector, const TAllocator& allocator) const {
+    return order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending, allocator);
+  }
+
+  /**
+   * @brief Same as order_by, but sorts the elements in parallel.
+   * Subsequent then_by operations are sorted in parallel as well.
+   * @param executor The executor that sorts the elements. The range keeps a reference to it,
+   * so it must outlive the range. The shared thread pool is used if no executor is specified.
+   */
+  template <typename TKeySelector, typename TExecutor>
+  [[nodiscard]] auto
+  parallel_order_by(TKeySelector&& key_selector, sort_direction sort_dir, TExecutor& executor) const;
+
+  /**
+   * @brief Same as parallel_order_by(key_selector, sort_dir, executor), but allocates the sort buffers
+   * from an allocator (see "Allocators"). They are only allocated on the calling thread, so an
+   * execution_context can be used as well.
+   */
+  template <typename TKeySelector, typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_order_by(TKeySelector&&    key_selector,
+                                       sort_direction    sort_dir,
+                                       TExecutor&        executor,
+                                       const TAllocator& allocator) const;
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto parallel_order_by(TKeySelector&& key_selector, sort_direction sort_dir) const {
+    return parallel_order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_dir, default_thread_pool());
+  }
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto parallel_order_by_ascending(TKeySelector&& key_selector) const {
+    return parallel_order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending);
+  }
+
+  template <typename TKeySelector, typename TExecutor>
+  [[nodiscard]] auto parallel_order_by_ascending(TKeySelector&& key_selector, TExecutor& executor) const {
+    return parallel_order_by<TKeySelector>(std::forward<TKeySelector>(key_selector),
+                                           sort_direction::ascending,
+                                           executor);
+  }
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto parallel_order_by_descending(TKeySelector&& key_selector) const {
+    return parallel_order_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending);
+  }
+
+  template <typename TKeySelector, typename TExecutor>
+  [[nodiscard]] auto parallel_order_by_descending(TKeySelector&& key_selector, TExecutor& executor) const {
+    return parallel_order_by<TKeySelector>(std::forward<TKeySelector>(key_selector),
+                                           sort_direction::descending,
+                                           executor);
+  }
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto then_by(TKeySelector&& key_selector, sort_direction sort_dir) const;
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto then_by_ascending(TKeySelector&& key_selector) const {
+    return then_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::ascending);
+  }
+
+  template <typename TKeySelector>
+  [[nodiscard]] auto then_by_descending(TKeySelector&& key_selector) const {
+    return then_by<TKeySelector>(std::forward<TKeySelector>(key_selector), sort_direction::descending);
+  }
+
+  [[nodiscard]] auto sum() const;
+  [[nodiscard]] auto min() const;
+  [[nodiscard]] auto max() const;
+
+  [[nodiscard]] auto sum_and_count() const;
+
+  [[nodiscard]] auto average() const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  ;
 
   template <typename TAccumFunc>
   [[nodiscard]] auto aggregate(const TAccumFunc& func) const;
 
-  [[nodiscard]] std::optional<output_t> first() const;
+  // Parallel aggregation
+  //
+  // These operators distribute the elements of a sliceable range (see is_sliceable) across the
+  // tasks of an executor (see linq::executor). The shared thread pool is used if no executor is
+  // specified. Ranges that can't be sliced are aggregated sequentially instead.
+  // The partial results of the tasks are allocated from the allocator that may follow the executor
+  // (see "Allocators"), on the calling thread only.
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_sum(TExecutor&& executor) const {
+    return parallel_sum(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_sum(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_min(TExecutor&& executor) const {
+    return parallel_min(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_min(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_max(TExecutor&& executor) const {
+    return parallel_max(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_max(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_sum_and_count(TExecutor&& executor) const {
+    return parallel_sum_and_count(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_sum_and_count(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_average(TExecutor&& executor) const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  {
+    return parallel_average(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_average(TExecutor&& executor, const TAllocator& allocator) const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  ;
+
+  // Reproducible parallel aggregation
+  //
+  // Same as parallel_sum, parallel_sum_and_count and parallel_average, but the elements are
+  // summed in an order that only depends on the source, not on the executor. Floating-point
+  // results are therefore bit-identical for any number of threads.
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_reproducible_sum(TExecutor&& executor) const {
+    return parallel_reproducible_sum(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_reproducible_sum(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_reproducible_sum_and_count(TExecutor&& executor) const {
+    return parallel_reproducible_sum_and_count(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_reproducible_sum_and_count(TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor>
+  [[nodiscard]] auto parallel_reproducible_average(TExecutor&& executor) const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  {
+    return parallel_reproducible_average(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto parallel_reproducible_average(TExecutor&& executor, const TAllocator& allocator) const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  ;
+
+  [[nodiscard]] auto parallel_sum() const {
+    return parallel_sum(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_min() const {
+    return parallel_min(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_max() const {
+    return parallel_max(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_sum_and_count() const {
+    return parallel_sum_and_count(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_average() const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  {
+    return parallel_average(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_reproducible_sum() const {
+    return parallel_reproducible_sum(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_reproducible_sum_and_count() const {
+    return parallel_reproducible_sum_and_count(default_thread_pool());
+  }
+
+  [[nodiscard]] auto parallel_reproducible_average() const
+#ifdef __cpp_lib_concepts
+    requires(averageable<output_t> || number<output_t>)
+#endif
+  {
+    return parallel_reproducible_average(default_thread_pool());
+  }
+
+  /**
+   * @brief Aggregates the range in parallel.
+   * @param func The accumulation function, which must be associative and commutative,
+   * since partial results are combined in an unspecified order.
+   */
+  template <typename TAccumFunc, typename TExecutor>
+  [[nodiscard]] auto parallel_aggregate(const TAccumFunc& func, TExecutor&& executor) const {
+    return parallel_aggregate(func, executor, std::allocator<std::byte>());
+  }
+
+  template <typename TAccumFunc, typename TExecutor, typename TAllocator>
+  [[nodiscard]] auto
+  parallel_aggregate(const TAccumFunc& func, TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TAccumFunc>
+  [[nodiscard]] auto parallel_aggregate(const TAccumFunc& func) const {
+    return parallel_aggregate(func, default_thread_pool());
+  }
+
+  /**
+   * @brief Computes the inclusive prefix sums of the range in parallel.
+   * Indexed ranges are scanned in two passes: every block of elements is folded first,
+   * then every block is scanned starting from the fold of all blocks before it.
+   * @param operation The operation, which must be associative.
+   */
+  template <typename TOperation, typename TExecutor>
+  [[nodiscard]] std::vector<output_t> parallel_scan(const TOperation& operation, TExecutor&& executor) const {
+    return parallel_scan(operation, executor, std::allocator<output_t>());
+  }
+
+  template <typename TOperation>
+  [[nodiscard]] std::vector<output_t> parallel_scan(const TOperation& operation) const {
+    return parallel_scan(operation, default_thread_pool());
+  }
+
+  // Same as parallel_scan, but the result and the block offsets use an allocator (see "Allocators").
+  template <typename TOperation, typename TExecutor, typename TAllocator>
+  [[nodiscard]] std::vector<output_t, rebind_alloc_t<TAllocator, output_t>>
+  parallel_scan(const TOperation& operation, TExecutor&& executor, const TAllocator& allocator) const;
+
+  // Same as parallel_scan, but computes exclusive prefix sums that start with init.
+  template <typename TInit, typename TOperation, typename TExecutor>
+  [[nodiscard]] std::vector<TInit>
+  parallel_exclusive_scan(TInit init, const TOperation& operation, TExecutor&& executor) const {
+    return parallel_exclusive_scan(std::move(init), operation, executor, std::allocator<TInit>());
+  }
+
+  template <typename TInit, typename TOperation>
+  [[nodiscard]] std::vector<TInit> parallel_exclusive_scan(TInit init, const TOperation& operation) const {
+    return parallel_exclusive_scan(std::move(init), operation, default_thread_pool());
+  }
+
+  template <typename TInit, typename TOperation, typename TExecutor, typename TAllocator>
+  [[nodiscard]] std::vector<TInit, rebind_alloc_t<TAllocator, TInit>> parallel_exclusive_scan(
+      TInit init, const TOperation& operation, TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TExecutor, std::enable_if_t<is_executor_v<TExecutor>, int> = 0>
+  [[nodiscard]] size_t parallel_count(TExecutor&& executor) const {
+    return parallel_count(executor, std::allocator<std::byte>());
+  }
+
+  template <typename TExecutor, typename TAllocator, std::enable_if_t<is_executor_v<TExecutor>, int> = 0>
+  [[nodiscard]] size_t parallel_count(TExecutor&& executor, const TAllocator& allocator) const;
+
+  [[nodiscard]] size_t parallel_count() const {
+    return parallel_count(default_thread_pool());
+  }
+
+  template <typename TPredicate, typename TExecutor, std::enable_if_t<!is_executor_v<TPredicate>, int> = 0>
+  [[nodiscard]] size_t parallel_count(const TPredicate& predicate, TExecutor&& executor) const {
+    return parallel_count(predicate, executor, std::allocator<std::byte>());
+  }
+
+  template <typename TPredicate, typename TExecutor, typename TAllocator>
+  [[nodiscard]] size_t
+  parallel_count(const TPredicate& predicate, TExecutor&& executor, const TAllocator& allocator) const;
+
+  template <typename TPredicate, std::enable_if_t<!is_executor_v<TPredicate>, int> = 0>
+  [[nodiscard]] size_t parallel_count(const TPredicate& predicate) const {
+    return parallel_count(predicate, default_thread_pool());
+  }
+
+  [[nodiscard]] std::optional<output_t> first() const;
+
+  template <typename TPredicate>
+  [[nodiscard]] std::optional<output_t> first(const TPredicate& predicate) const;
+
+  /**
+   * @brief Gets the last element. Indexed ranges (see is_indexed) compute only that element, so the
+   * transforms of select() aren't invoked for the preceding ones.
+   */
+  [[nodiscard]] std::optional<output_t> last() const;
+
+  template <typename TPredicate>
+  [[nodiscard]] std::optional<output_t> last(const TPredicate& predicate) const;
+
+  /*
+   * The following functions locate an element without copying it. They return a pointer to
+   * the element, or nullptr if there is no such element. They require a range whose elements are
+   * references, e.g. ranges over containers, and the filtering, sorting and partitioning operators
+   * on top of them. The pointer stays valid as long as the source and the range exist, and the range
+   * isn't iterated again (which would re-sort a sorted range, for example). Ranges that store their
+   * elements (see holds_elements), such as sorted ranges and anything built on them, have to be stored
+   * in a variable first; on a temporary, the pointer would dangle.
+   */
+
+  [[nodiscard]] auto first_ref() const&;
+
+  [[nodiscard]] auto first_ref() const&& {
+    check_element_owner();
+    return first_ref();
+  }
+
+  template <typename TPredicate>
+  [[nodiscard]] auto first_ref(const TPredicate& predicate) const&;
+
+  template <typename TPredicate>
+  [[nodiscard]] auto first_ref(const TPredicate& predicate) const&& {
+    check_element_owner();
+    return first_ref(predicate);
+  }
+
+  // Takes constant time on indexed ranges (see is_indexed).
+  [[nodiscard]] auto last_ref() const&;
+
+  [[nodiscard]] auto last_ref() const&& {
+    check_element_owner();
+    return last_ref();
+  }
+
+  template <typename TPredicate>
+  [[nodiscard]] auto last_ref(const TPredicate& predicate) const&;
+
+  template <typename TPredicate>
+  [[nodiscard]] auto last_ref(const TPredicate& predicate) const&& {
+    check_element_owner();
+    return last_ref(predicate);
+  }
+
+  // Takes constant time on indexed ranges (see is_indexed).
+  [[nodiscard]] auto element_at_ref(size_t index) const&;
+
+  [[nodiscard]] auto element_at_ref(size_t index) const&& {
+    check_element_owner();
+    return element_at_ref(index);
+  }
+
+  template <typename TPredicate>
+  [[nodiscard]] bool any(const TPredicate& predicate) const;
+
+  /**
+   * @brief Determines whether the range contains an element that is equal to value.
+   * Associative sources (see is_associative) only compare the elements whose key is equivalent
+   * to the key of value, as found by the container's equal_range; for maps only the mapped values
+   * are compared then. Contiguous ranges are searched with std::find_if, other ranges are scanned.
+   * Pairs are compared member by member, so a pair<K, V> can be looked up in a map.
+   */
+  template <typename TValue>
+  [[nodiscard]] bool contains(const TValue& value) const;
+
+  /**
+   * @brief Obtains an element whose key is equal to key, where the key of pairs (e.g. map entries) is
+   * their first member and the key of other elements is the element itself.
+   * Associative sources (see is_associative) look the key up using the container's find instead.
+   */
+  template <typename TKey>
+  [[nodiscard]] std::optional<output_t> find_key(const TKey& key) const;
+
+  template <typename TPredicate>
+  [[nodiscard]] bool all(const TPredicate& predicate) const;
+
+  template <typename TPredicate>
+  [[nodiscard]] bool none(const TPredicate& predicate) const;
+
+  /**
+   * @brief Counts the elements. Indexed ranges (see is_indexed) know their count without iterating,
+   * so e.g. count() on from(&v).select(f) doesn't invoke f. Use count(predicate) to visit every element.
+   */
+  [[nodiscard]] size_t count() const;
+
+  template <typename TPredicate>
+  [[nodiscard]] size_t count(const TPredicate& predicate) const;
+
+  /**
+   * @brief Gets the element at an index. Like last(), indexed ranges compute only that element.
+   */
+  [[nodiscard]] std::optional<output_t> element_at(size_t index) const;
+
+  /**
+   * @brief Copies the elements to a new std::vector. Elements that the range computes
+   * (e.g. in select) are moved into the vector instead.
+   */
+  [[nodiscard]] std::vector<output_t> to_vector() const&;
+
+  /**
+   * @brief Same as to_vector() const&, but moves the elements out of ranges that own them
+   * (see owns_elements), which leaves the range empty.
+   */
+  [[nodiscard]] std::vector<output_t> to_vector() &&;
+
+  /**
+   * @brief Same as to_vector(), but the vector uses an allocator (see "Allocators").
+   */
+  template <typename TAllocator>
+  [[nodiscard]] std::vector<output_t, rebind_alloc_t<TAllocator, output_t>> to_vector(const TAllocator& allocator) const;
+
+  /**
+   * @brief Splits the range into the elements that satisfy a predicate and the ones that don't,
+   * in a single pass. Both keep their order. Neither vector is reserved upfront, since the split
+   * isn't known in advance; both grow as elements are appended.
+   * @return The matching elements (first) and the non-matching elements (second)
+   */
+  template <typename TPredicate>
+  [[nodiscard]] std::pair<std::vector<output_t>, std::vector<output_t>> partition(const TPredicate& predicate) const;
+
+  /**
+   * @brief Splits the range like partition(predicate), but appends the elements to existing containers.
+   * The containers may be of any type that supports insert(end(), value), such as std::vector,
+   * std::deque, std::list or std::set.
+   */
+  template <typename TPredicate, typename TMatching, typename TNonMatching>
+  void partition(const TPredicate& predicate, TMatching& matching, TNonMatching& non_matching) const;
+
+  /**
+   * @brief Same as partition(predicate), but the vectors use an allocator (see "Allocators").
+   */
+  template <typename TPredicate, typename TAllocator>
+  [[nodiscard]] auto partition(const TPredicate& predicate, const TAllocator& allocator) const;
+
+  /**
+   * @brief Appends the elements to an existing container, e.g. std::vector, std::deque, std::list,
+   * std::set, std::map or flat containers. If the number of elements is known upfront (see is_indexed),
+   * room for them is reserved first.
+   * @return The container
+   */
+  template <typename TContainer>
+  TContainer& append_to(TContainer& container) const;
+
+  /**
+   * @brief Replaces the contents of an existing container with the elements.
+   * The container is cleared rather than recreated, so a std::vector keeps its capacity,
+   * and refilling it in a loop stops allocating once it's large enough.
+   * @return The container
+   */
+  template <typename TContainer>
+  TContainer& assign_to(TContainer& container) const;
+
+  /**
+   * @brief Same as assign_to(container).
+   */
+  template <typename TContainer>
+  TContainer& into(TContainer& container) const {
+    return assign_to(container);
+  }
+
+  /**
+   * @brief Concatenates the elements, with a separator between each two of them.
+   * Strings, string views and characters are appended as they are, numbers are formatted
+   * with std::to_chars (see select_to_string_view). If the range is contiguous storage of strings
+   * (see is_contiguous), their total length is computed upfront, so that the result is allocated exactly
+   * once. Other ranges are iterated only once.
+   */
+  [[nodiscard]] std::string string_join(std::string_view separator) const;
+
+  /**
+   * @brief Same as string_join(separator), but with a custom formatter for the elements. It is either
+   * invoked as formatter(element) and returns something that can be appended to a std::string,
+   * or as formatter(std::string& out, element) and appends to out directly (which avoids
+   * a temporary string per element).
+   */
+  template <typename TFormatter>
+  [[nodiscard]] std::string string_join(std::string_view separator, const TFormatter& formatter) const;
+
+  [[nodiscard]] auto to_map() const&;
+
+  // Moves the elements out of ranges that own them (see owns_elements).
+  [[nodiscard]] auto to_map() &&;
+
+  template <typename TAllocator>
+  [[nodiscard]] auto to_map(const TAllocator& allocator) const;
+
+  [[nodiscard]] auto to_unordered_map() const&;
+
+  // Moves the elements out of ranges that own them (see owns_elements).
+  [[nodiscard]] auto to_unordered_map() &&;
+
+  template <typename TAllocator>
+  [[nodiscard]] auto to_unordered_map(const TAllocator& allocator) const;
+
+private:
+  static constexpr void check_element_owner() {
+    static_assert(!TMy::holds_elements,
+                  "The elements of a temporary range that stores them are destroyed with it; store the range in a "
+                  "variable before calling first_ref, last_ref or element_at_ref.");
+  }
+};
+
+// ----------------------------------
+// where
+// ----------------------------------
+
+template <typename TPrevRange, typename TPredicate>
+class where_range : public base_range<where_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = typename prev_iter_t::output_t;
+
+    iterator(const where_range* parent, prev_iter_t begin, prev_iter_t end)
+        : m_parent(parent)
+        , m_begin(begin)
+        , m_end(end) {
+      const auto& pred = m_parent->m_predicate;
+
+      // Seek the first match.
+      while (m_begin != m_end && !pred(*m_begin)) {
+        ++m_begin;
+      }
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
+    }
+
+    iterator& operator++() {
+      const auto& pred = m_parent->m_predicate;
+
+      do {
+        ++m_begin;
+      } while (m_begin != m_end && !pred(*m_begin));
+
+      return *this;
+    }
+
+    decltype(auto) operator*() const {
+      return *m_begin;
+    }
+
+    const where_range* m_parent;
+    prev_iter_t        m_begin;
+    prev_iter_t        m_end;
+  };
+
+  where_range() = default;
+
+  where_range(const TPrevRange& prev, TPredicate predicate)
+      : m_prev(prev)
+      , m_predicate(std::move(predicate)) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    return iterator(this, m_prev.begin(), m_prev.end());
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator(this, prev_end, prev_end);
+  }
+
+  static constexpr bool is_sliceable = TPrevRange::is_sliceable;
+
+  size_t slice_count() const {
+    return m_prev.slice_count();
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto [prev_first, prev_last] = m_prev.slice(first, last);
+    return {iterator(this, prev_first, prev_last), iterator(this, prev_last, prev_last)};
+  }
+
+private:
+  TPrevRange m_prev;
+  TPredicate m_predicate;
+};
+
+// ----------------------------------
+// distinct
+// ----------------------------------
+
+template <typename TPrevRange, typename TAllocator>
+class distinct_range
+    : public base_range<distinct_range<TPrevRange, TAllocator>, typename TPrevRange::iterator::output_t> {
+  using prev_iter_t      = typename TPrevRange::iterator;
+  using object_buffer    = scratch_buffer<prev_iter_t, TAllocator>;
+  using object_container = typename object_buffer::container_t;
+
+public:
+  struct iterator {
+    using output_t = typename prev_iter_t::output_t;
+
+    iterator(prev_iter_t begin, prev_iter_t end, object_container* encountered_objects)
+        : m_begin(begin)
+        , m_end(end)
+        , m_encountered_objects(encountered_objects) {
+      if (m_begin != m_end) {
+        encountered_objects->clear();
+        encountered_objects->push_back(m_begin);
+      }
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
+    }
+
+    iterator& operator++() {
+      do {
+        ++m_begin;
+      } while (m_begin != m_end && contains_object(m_begin));
+
+      if (m_begin != m_end)
+        m_encountered_objects->push_back(m_begin);
+
+      return *this;
+    }
+
+    bool contains_object(const prev_iter_t& it) {
+      const auto& it_val = *it;
+
+      const auto&  encountered_objects = *m_encountered_objects;
+      const size_t size                = encountered_objects.size();
+
+      for (size_t i = 0; i < size; ++i) {
+        if (*encountered_objects[i] == it_val) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    decltype(auto) operator*() const {
+      return *m_begin;
+    }
+
+    prev_iter_t       m_begin;
+    prev_iter_t       m_end;
+    object_container* m_encountered_objects;
+  };
+
+  distinct_range() = default;
+
+  explicit distinct_range(const TPrevRange& prev, const TAllocator& allocator = TAllocator())
+      : m_prev(prev)
+      , m_encountered_objects(allocator) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    return iterator{m_prev.begin(), m_prev.end(), std::addressof(m_encountered_objects.values())};
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator{prev_end, prev_end, std::addressof(m_encountered_objects.values())};
+  }
+
+private:
+  TPrevRange            m_prev;
+  mutable object_buffer m_encountered_objects;
+};
+
+// ----------------------------------
+// select
+// ----------------------------------
+
+// Resolves the arguments that are passed to a select functor.
+template <typename TPrevRange>
+using select_transform_arg_t = std::add_const_t<std::add_lvalue_reference_t<typename TPrevRange::iterator::output_t>>;
+
+// Resolves the return type of a select functor.
+template <typename TPrevRange, typename TTransform>
+using select_output_t = std::invoke_result_t<TTransform, select_transform_arg_t<TPrevRange>>;
+
+// The transform of select_member().
+template <typename TClass, typename TMember>
+struct member_selector {
+  const TMember& operator()(const TClass& obj) const {
+    return obj.*m_member;
+  }
+
+  TMember TClass::*m_member;
+};
+
+template <typename TPrevRange, typename TTransform>
+class select_range : public base_range<select_range<TPrevRange, TTransform>, select_output_t<TPrevRange, TTransform>> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = select_output_t<TPrevRange, TTransform>;
+
+    iterator(const select_range* parent, prev_iter_t begin, prev_iter_t end)
+        : m_parent(parent)
+        , m_begin(begin)
+        , m_end(end) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
+    }
+
+    iterator& operator++() {
+      ++m_begin;
+      return *this;
+    }
+
+    output_t operator*() const {
+      return m_parent->m_transform(*m_begin);
+    }
+
+    const select_range* m_parent;
+    prev_iter_t         m_begin;
+    prev_iter_t         m_end;
+  };
+
+  select_range(const TPrevRange& prev, TTransform transform)
+      : m_prev(prev)
+      , m_transform(std::move(transform)) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    return iterator(this, m_prev.begin(), m_prev.end());
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator(this, prev_end, prev_end);
+  }
+
+  static constexpr bool is_sliceable = TPrevRange::is_sliceable;
+  static constexpr bool is_indexed   = TPrevRange::is_indexed;
+
+  size_t slice_count() const {
+    return m_prev.slice_count();
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto [prev_first, prev_last] = m_prev.slice(first, last);
+    return {iterator(this, prev_first, prev_last), iterator(this, prev_last, prev_last)};
+  }
+
+  select_output_t<TPrevRange, TTransform> at(size_t index) const {
+    return m_transform(m_prev.at(index));
+  }
+
+private:
+  TPrevRange m_prev;
+  TTransform m_transform{};
+};
+
+// ----------------------------------
+// select_to_string
+// ----------------------------------
+
+template <typename TPrevRange>
+class select_to_string_range : public base_range<select_to_string_range<TPrevRange>, std::string> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = std::string;
+
+    iterator(const select_to_string_range* parent, prev_iter_t begin, prev_iter_t end)
+        : m_parent(parent)
+        , m_begin(begin)
+        , m_end(end) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
+    }
+
+    iterator& operator++() {
+      ++m_begin;
+      return *this;
+    }
+
+    output_t operator*() const {
+      return std::to_string(*m_begin);
+    }
+
+    const select_to_string_range* m_parent{};
+    prev_iter_t                   m_begin;
+    prev_iter_t                   m_end;
+  };
+
+  explicit select_to_string_range(const TPrevRange& prev)
+      : m_prev(prev) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    return iterator{this, m_prev.begin(), m_prev.end()};
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator{this, prev_end, prev_end};
+  }
+
+  static constexpr bool is_sliceable = TPrevRange::is_sliceable;
+
+  size_t slice_count() const {
+    return m_prev.slice_count();
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto [prev_first, prev_last] = m_prev.slice(first, last);
+    return {iterator{this, prev_first, prev_last}, iterator{this, prev_last, prev_last}};
+  }
+
+private:
+  TPrevRange m_prev;
+};
+
+// ----------------------------------
+// select_to_string_view
+// ----------------------------------
+
+// Formats a floating-point number on standard libraries without std::to_chars support for it.
+template <typename T>
+std::to_chars_result format_float_fallback(char* first, char* last, T value, float_format format) {
+  const auto  size      = static_cast<size_t>(last - first);
+  const auto  ld_value  = static_cast<long double>(value);
+  const int   precision = format.precision >= 0 ? format.precision : std::numeric_limits<T>::max_digits10;
+  int         length    = 0;
+
+  switch (format.notation) {
+    case std::chars_format::fixed: length = std::snprintf(first, size, "%.*Lf", precision, ld_value); break;
+    case std::chars_format::scientific: length = std::snprintf(first, size, "%.*Le", precision, ld_value); break;
+    case std::chars_format::hex:
+      length = format.precision >= 0 ? std::snprintf(first, size, "%.*La", precision, ld_value)
+                                     : std::snprintf(first, size, "%La", ld_value);
+      break;
+    default: length = std::snprintf(first, size, "%.*Lg", precision, ld_value); break;
+  }
+
+  if (length < 0 || static_cast<size_t>(length) >= size) {
+    return {last, std::errc::value_too_large};
+  }
+
+  return {first + length, std::errc{}};
+}
+
+// Formats a number into [first, last).
+template <typename T>
+std::to_chars_result format_number(char* first, char* last, const T& value, float_format format) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return std::to_chars(first, last, static_cast<int>(value));
+  }
+  else if constexpr (std::is_integral_v<T>) {
+    return std::to_chars(first, last, value);
+  }
+  else {
+    static_assert(std::is_floating_point_v<T>, "select_to_string_view requires numbers or strings.");
+
+#ifdef __cpp_lib_to_chars
+    return format.precision < 0 ? std::to_chars(first, last, value, format.notation)
+                                : std::to_chars(first, last, value, format.notation, format.precision);
+#else
+    return format_float_fallback(first, last, value, format);
+#endif
+  }
+}
 
-  template <typename TPredicate>
-  [[nodiscard]] std::optional<output_t> first(const TPredicate& predicate) const;
+template <typename TPrevRange>
+struct select_to_string_view_traits {
+  using prev_output_t = typename TPrevRange::iterator::output_t;
+  using element_t     = std::decay_t<prev_output_t>;
+
+  // Stored strings and string views are viewed directly. Everything else, including strings that are
+  // returned by value, is copied or formatted into the iterator.
+  static constexpr bool passes_through =
+      std::is_convertible_v<const element_t&, std::string_view> &&
+      (std::is_lvalue_reference_v<prev_output_t> || std::is_same_v<element_t, std::string_view> ||
+       std::is_pointer_v<element_t>);
+
+  using output_t = std::conditional_t<passes_through, std::string_view, formatted_text>;
+};
 
-  [[nodiscard]] std::optional<output_t> last() const;
+template <typename TPrevRange, typename TAllocator>
+class select_to_string_view_range
+    : public base_range<select_to_string_view_range<TPrevRange, TAllocator>,
+                        typename select_to_string_view_traits<TPrevRange>::output_t> {
+public:
+  using traits_t   = select_to_string_view_traits<TPrevRange>;
+  using element_t  = typename traits_t::element_t;
+  using overflow_t = std::basic_string<char, std::char_traits<char>, rebind_alloc_t<TAllocator, char>>;
+
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = typename traits_t::output_t;
+
+    iterator(const select_to_string_view_range* parent, prev_iter_t begin, prev_iter_t end)
+        : m_parent(parent)
+        , m_begin(begin)
+        , m_end(end)
+        , m_overflow(rebind_alloc_t<TAllocator, char>(parent->m_allocator)) {
+    }
+
+    // The buffer isn't copied; the copy formats its element again if needed.
+    iterator(const iterator& copy_from)
+        : m_parent(copy_from.m_parent)
+        , m_begin(copy_from.m_begin)
+        , m_end(copy_from.m_end)
+        , m_overflow(copy_from.m_overflow.get_allocator()) {
+    }
+
+    iterator& operator=(const iterator& copy_from) {
+      m_parent = copy_from.m_parent;
+      m_begin  = copy_from.m_begin;
+      m_end    = copy_from.m_end;
+      m_text   = {};
+      return *this;
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
+    }
+
+    iterator& operator++() {
+      ++m_begin;
+      m_text = {};
+      return *this;
+    }
+
+    output_t operator*() const {
+      if constexpr (traits_t::passes_through) {
+        return *m_begin;
+      }
+      else {
+        if (m_text.data() == nullptr) {
+          if constexpr (std::is_convertible_v<const element_t&, std::string_view>) {
+            m_overflow.assign(std::string_view(*m_begin));
+            m_text = m_overflow;
+          }
+          else {
+            format(*m_begin);
+          }
+        }
+
+        return output_t(m_text);
+      }
+    }
+
+    void format(const element_t& value) const {
+      const auto [end, error] =
+          format_number(m_buffer.data(), m_buffer.data() + m_buffer.size(), value, m_parent->m_format);
+
+      if (error == std::errc{}) {
+        m_text = std::string_view(m_buffer.data(), static_cast<size_t>(end - m_buffer.data()));
+        return;
+      }
+
+      // Only very long fixed-notation numbers end up here.
+      m_overflow.resize(std::max(m_overflow.size(), m_buffer.size()));
+
+      for (;;) {
+        m_overflow.resize(m_overflow.size() * 2);
+
+        const auto [overflow_end, overflow_error] =
+            format_number(m_overflow.data(), m_overflow.data() + m_overflow.size(), value, m_parent->m_format);
+
+        if (overflow_error == std::errc{}) {
+          m_text = std::string_view(m_overflow.data(), static_cast<size_t>(overflow_end - m_overflow.data()));
+          return;
+        }
+      }
+    }
+
+    const select_to_string_view_range* m_parent{};
+    prev_iter_t                        m_begin;
+    prev_iter_t                        m_end;
+    mutable std::string_view           m_text;
+    mutable std::array<char, 64>       m_buffer;
+    mutable overflow_t                 m_overflow;
+  };
+
+  select_to_string_view_range(const TPrevRange& prev, float_format format, const TAllocator& allocator = TAllocator())
+      : m_prev(prev)
+      , m_format(format)
+      , m_allocator(allocator) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    return iterator{this, m_prev.begin(), m_prev.end()};
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator{this, prev_end, prev_end};
+  }
+
+  static constexpr bool is_sliceable = TPrevRange::is_sliceable;
+
+  size_t slice_count() const {
+    return m_prev.slice_count();
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto [prev_first, prev_last] = m_prev.slice(first, last);
+    return {iterator{this, prev_first, prev_last}, iterator{this, prev_last, prev_last}};
+  }
+
+private:
+  TPrevRange   m_prev;
+  float_format m_format;
+  TAllocator   m_allocator;
+};
+
+// ----------------------------------
+// select_many
+// ----------------------------------
+
+template <typename TPrevRange, typename TTransform>
+struct select_many_traits {
+  using returned_range_t = std::invoke_result_t<TTransform, typename TPrevRange::iterator::output_t>;
+
+  // See if the returned type is really a range.
+  static_assert(std::is_base_of_v<base_range_ident, returned_range_t>,
+                "The transform function of select_many is expected to return a LINQ range.");
+
+  using output_t = typename returned_range_t::iterator::output_t;
+};
+
+template <typename TPrevRange, typename TTransform>
+class select_many_range : public base_range<select_many_range<TPrevRange, TTransform>,
+                                            typename select_many_traits<TPrevRange, TTransform>::output_t> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+
+    using returned_range_t      = typename select_many_traits<TPrevRange, TTransform>::returned_range_t;
+    using returned_range_iter_t = typename returned_range_t::iterator;
+    using output_t              = typename returned_range_iter_t::output_t;
+
+    // The position in the returned range. Indexed ranges are walked by index, because their iterators
+    // may point into the range itself (e.g. into the inline storage of from({...})), and would keep
+    // pointing into the returned range of the original when this iterator is copied.
+    struct index_position {
+      size_t index{};
+      size_t count{};
+    };
+
+    struct iterator_position {
+      returned_range_iter_t begin{};
+      returned_range_iter_t end{};
+    };
+
+    using position_t = std::conditional_t<returned_range_t::is_indexed, index_position, iterator_position>;
+
+    iterator(const select_many_range* parent, prev_iter_t pos, prev_iter_t end)
+        : m_parent(parent)
+        , m_pos(std::move(pos))
+        , m_end(std::move(end)) {
+      seek_element();
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_pos == o.m_pos;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_pos != o.m_pos;
+    }
+
+    iterator& operator++() {
+      if constexpr (returned_range_t::is_indexed) {
+        ++m_ret_pos.index;
+      }
+      else {
+        ++m_ret_pos.begin;
+      }
+
+      if (is_returned_range_done()) {
+        ++m_pos;
+        seek_element();
+      }
+
+      return *this;
+    }
+
+    decltype(auto) operator*() const {
+      if constexpr (returned_range_t::is_indexed) {
+        return m_ret_range.at(m_ret_pos.index);
+      }
+      else {
+        return *m_ret_pos.begin;
+      }
+    }
+
+    bool is_returned_range_done() const {
+      if constexpr (returned_range_t::is_indexed) {
+        return m_ret_pos.index == m_ret_pos.count;
+      }
+      else {
+        return m_ret_pos.begin == m_ret_pos.end;
+      }
+    }
+
+    // Transforms the source elements, starting at m_pos, until one returns a non-empty range.
+    void seek_element() {
+      const auto& transform = m_parent->m_transform;
+
+      for (; m_pos != m_end; ++m_pos) {
+        m_ret_range = transform(*m_pos);
+
+        if constexpr (returned_range_t::is_indexed) {
+          m_ret_pos = index_position{0, m_ret_range.slice_count()};
+        }
+        else {
+          m_ret_pos = iterator_position{m_ret_range.begin(), m_ret_range.end()};
+        }
+
+        if (!is_returned_range_done()) {
+          break;
+        }
+      }
+    }
+
+    const select_many_range* m_parent;
+    prev_iter_t              m_pos;
+    prev_iter_t              m_end;
+
+    returned_range_t m_ret_range;
+    position_t       m_ret_pos;
+  };
+
+  select_many_range() = default;
+
+  select_many_range(const TPrevRange& prev, TTransform transform)
+      : m_prev(prev)
+      , m_transform(std::move(transform)) {
+  }
+
+  static constexpr bool holds_elements =
+      TPrevRange::holds_elements || select_many_traits<TPrevRange, TTransform>::returned_range_t::holds_elements;
+
+  iterator begin() const {
+    return iterator{this, m_prev.begin(), m_prev.end()};
+  }
+
+  iterator end() const {
+    const auto prev_end = m_prev.end();
+    return iterator{this, prev_end, prev_end};
+  }
+
+private:
+  TPrevRange m_prev;
+  TTransform m_transform;
+};
+
+// ----------------------------------
+// reverse
+// ----------------------------------
+
+template <typename TPrevRange, typename TAllocator>
+class reverse_range
+    : public base_range<reverse_range<TPrevRange, TAllocator>, typename TPrevRange::iterator::output_t> {
+public:
+  using prev_iter_t      = typename TPrevRange::iterator;
+  using object_buffer    = scratch_buffer<prev_iter_t, TAllocator>;
+  using object_container = typename object_buffer::container_t;
+
+  struct iterator {
+    using output_t = typename prev_iter_t::output_t;
+
+    iterator(const object_container* prev_iterators, size_t index)
+        : m_prev_iterators(prev_iterators)
+        , m_index(index) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_index == o.m_index;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_index != o.m_index;
+    }
+
+    iterator& operator++() {
+      --m_index;
+      return *this;
+    }
+
+    decltype(auto) operator*() const {
+      return *(*m_prev_iterators)[m_index];
+    }
+
+    const object_container* m_prev_iterators;
+    size_t                  m_index{};
+  };
+
+  reverse_range() = default;
+
+  explicit reverse_range(const TPrevRange& prev, const TAllocator& allocator = TAllocator())
+      : m_prev(prev)
+      , m_prev_iterators(allocator) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    auto& prev_iterators = m_prev_iterators.values();
+    prev_iterators.clear();
+
+    for (auto beg = m_prev.begin(), end = m_prev.end(); beg != end; ++beg) {
+      prev_iterators.push_back(beg);
+    }
+
+    return iterator{std::addressof(prev_iterators), prev_iterators.size() - 1};
+  }
+
+  iterator end() const {
+    return iterator{nullptr, static_cast<size_t>(-1)};
+  }
+
+private:
+  TPrevRange            m_prev;
+  mutable object_buffer m_prev_iterators;
+};
+
+// ----------------------------------
+// take
+// ----------------------------------
+
+template <typename TPrevRange>
+class take_range : public base_range<take_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = typename prev_iter_t::output_t;
+
+    iterator(prev_iter_t begin, size_t count)
+        : m_begin(begin)
+        , m_count(count) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_count == o.m_count || m_begin == o.m_begin;
+    }
 
-  template <typename TPredicate>
-  [[nodiscard]] std::optional<output_t> last(const TPredicate& predicate) const;
+    bool operator!=(const iterator& o) const {
+      return m_count != o.m_count && m_begin != o.m_begin;
+    }
 
-  template <typename TPredicate>
-  [[nodiscard]] bool any(const TPredicate& predicate) const;
+    iterator& operator++() {
+      ++m_begin;
+      --m_count;
+      return *this;
+    }
 
-  template <typename TPredicate>
-  [[nodiscard]] bool all(const TPredicate& predicate) const;
+    decltype(auto) operator*() const {
+      return *m_begin;
+    }
 
-  template <typename TPredicate>
-  [[nodiscard]] bool none(const TPredicate& predicate) const;
+    prev_iter_t m_begin;
+    size_t      m_count{};
+  };
 
-  [[nodiscard]] size_t count() const;
+  take_range() = default;
 
-  template <typename TPredicate>
-  [[nodiscard]] size_t count(const TPredicate& predicate) const;
+  take_range(const TPrevRange& prev, size_t count)
+      : m_prev(prev)
+      , m_count(count) {
+  }
 
-  [[nodiscard]] std::optional<output_t> element_at(size_t index) const;
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
 
-  [[nodiscard]] std::vector<output_t> to_vector() const;
+  iterator begin() const {
+    return iterator(m_prev.begin(), m_count);
+  }
 
-  [[nodiscard]] auto to_map() const;
+  iterator end() const {
+    return iterator(m_prev.end(), 0);
+  }
 
-  [[nodiscard]] auto to_unordered_map() const;
+private:
+  TPrevRange m_prev;
+  size_t     m_count{};
 };
 
 // ----------------------------------
-// where
+// take_while
 // ----------------------------------
 
 template <typename TPrevRange, typename TPredicate>
-class where_range : public base_range<where_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
+class take_while_range
+    : public base_range<take_while_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
 public:
   struct iterator {
     using prev_iter_t = typename TPrevRange::iterator;
     using output_t    = typename prev_iter_t::output_t;
 
-    iterator(const where_range* parent, prev_iter_t begin, prev_iter_t end)
+    iterator(const take_while_range* parent, prev_iter_t begin, prev_iter_t end)
         : m_parent(parent)
         , m_begin(begin)
         , m_end(end) {
       const auto& pred = m_parent->m_predicate;
 
-      // Seek the first match.
-      while (m_begin != m_end && !pred(*m_begin)) {
-        ++m_begin;
+      if (m_begin != m_end && !pred(*m_begin)) {
+        m_begin = m_end;
       }
     }
 
@@ -315,38 +3256,41 @@ public:
     }
 
     iterator& operator++() {
+      ++m_begin;
+
       const auto& pred = m_parent->m_predicate;
 
-      do {
-        ++m_begin;
-      } while (m_begin != m_end && !pred(*m_begin));
+      if (m_begin != m_end && !pred(*m_begin)) {
+        m_begin = m_end;
+      }
 
       return *this;
     }
 
-    const output_t& operator*() const {
+    decltype(auto) operator*() const {
       return *m_begin;
     }
 
-    const where_range* m_parent;
-    prev_iter_t        m_begin;
-    prev_iter_t        m_end;
+    const take_while_range* m_parent;
+    prev_iter_t             m_begin;
+    prev_iter_t             m_end;
   };
 
-  where_range() = default;
+  take_while_range() = default;
 
-  where_range(const TPrevRange& prev, TPredicate predicate)
+  take_while_range(const TPrevRange& prev, TPredicate predicate)
       : m_prev(prev)
       , m_predicate(std::move(predicate)) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
     return iterator(this, m_prev.begin(), m_prev.end());
   }
 
   iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator(this, prev_end, prev_end);
+    return iterator(this, m_prev.end(), m_prev.end());
   }
 
 private:
@@ -355,25 +3299,25 @@ private:
 };
 
 // ----------------------------------
-// distinct
+// skip
 // ----------------------------------
 
 template <typename TPrevRange>
-class distinct_range : public base_range<distinct_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
-  using prev_iter_t      = typename TPrevRange::iterator;
-  using object_container = std::vector<prev_iter_t>;
-
+class skip_range : public base_range<skip_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
 public:
   struct iterator {
-    using output_t = typename prev_iter_t::output_t;
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = typename prev_iter_t::output_t;
 
-    iterator(prev_iter_t begin, prev_iter_t end, object_container* encountered_objects)
-        : m_begin(begin)
-        , m_end(end)
-        , m_encountered_objects(encountered_objects) {
-      if (m_begin != m_end) {
-        encountered_objects->clear();
-        encountered_objects->push_back(m_begin);
+    explicit iterator(prev_iter_t begin)
+        : m_begin(begin) {
+    }
+
+    iterator(prev_iter_t begin, prev_iter_t end, size_t count)
+        : m_begin(begin) {
+      while (m_begin != end && count > 0) {
+        ++m_begin;
+        --count;
       }
     }
 
@@ -386,438 +3330,582 @@ public:
     }
 
     iterator& operator++() {
-      do {
-        ++m_begin;
-      } while (m_begin != m_end && contains_object(m_begin));
+      ++m_begin;
+      return *this;
+    }
 
-      if (m_begin != m_end)
-        m_encountered_objects->push_back(m_begin);
+    decltype(auto) operator*() const {
+      return *m_begin;
+    }
 
-      return *this;
+    prev_iter_t m_begin;
+  };
+
+  skip_range(const TPrevRange& prev, size_t count)
+      : m_prev(prev)
+      , m_count(count) {
+  }
+
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
+  iterator begin() const {
+    if constexpr (is_indexed) {
+      // Seek the first element directly instead of stepping over the skipped ones.
+      return iterator(slice(0, slice_count()).first);
     }
+    else {
+      return iterator(m_prev.begin(), m_prev.end(), m_count);
+    }
+  }
 
-    bool contains_object(const prev_iter_t& it) {
-      const auto& it_val = *it;
+  iterator end() const {
+    if constexpr (is_indexed) {
+      return iterator(slice(0, slice_count()).second);
+    }
+    else {
+      const auto prev_end = m_prev.end();
+      return iterator(prev_end, prev_end, 0);
+    }
+  }
 
-      const auto&  encountered_objects = *m_encountered_objects;
-      const size_t size                = encountered_objects.size();
+  static constexpr bool is_sliceable = TPrevRange::is_indexed;
+  static constexpr bool is_indexed   = TPrevRange::is_indexed;
 
-      for (size_t i = 0; i < size; ++i) {
-        if (*encountered_objects[i] == it_val) {
-          return true;
-        }
+  size_t slice_count() const {
+    const size_t prev_count = m_prev.slice_count();
+    return prev_count - std::min(m_count, prev_count);
+  }
+
+  decltype(auto) at(size_t index) const {
+    return m_prev.at(m_count + index);
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const size_t offset                = std::min(m_count, m_prev.slice_count());
+    const auto [prev_first, prev_last] = m_prev.slice(offset + first, offset + last);
+
+    return {iterator(prev_first), iterator(prev_last)};
+  }
+
+private:
+  TPrevRange m_prev;
+  size_t     m_count{};
+};
+
+// ----------------------------------
+// skip_while
+// ----------------------------------
+
+template <typename TPrevRange, typename TPredicate>
+class skip_while_range
+    : public base_range<skip_while_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
+public:
+  struct iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = typename prev_iter_t::output_t;
+
+    iterator(prev_iter_t begin, prev_iter_t end, const TPredicate& predicate)
+        : m_begin(begin) {
+      while (m_begin != end && predicate(*m_begin)) {
+        ++m_begin;
       }
+    }
 
-      return false;
+    bool operator==(const iterator& o) const {
+      return m_begin == o.m_begin;
+    }
+    bool operator!=(const iterator& o) const {
+      return m_begin != o.m_begin;
     }
 
-    const output_t& operator*() const {
+    iterator& operator++() {
+      ++m_begin;
+      return *this;
+    }
+
+    decltype(auto) operator*() const {
       return *m_begin;
     }
 
-    prev_iter_t       m_begin;
-    prev_iter_t       m_end;
-    object_container* m_encountered_objects;
+    prev_iter_t m_begin;
   };
 
-  distinct_range() = default;
-
-  explicit distinct_range(const TPrevRange& prev)
-      : m_prev(prev) {
+  skip_while_range(const TPrevRange& prev, const TPredicate& predicate)
+      : m_prev(prev)
+      , m_predicate(&predicate) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator{m_prev.begin(), m_prev.end(), std::addressof(m_encountered_objects)};
+    return iterator(m_prev.begin(), m_prev.end(), *m_predicate);
   }
 
   iterator end() const {
     const auto prev_end = m_prev.end();
-    return iterator{prev_end, prev_end, std::addressof(m_encountered_objects)};
+    return iterator(prev_end, prev_end, *m_predicate);
   }
 
 private:
-  TPrevRange               m_prev;
-  mutable object_container m_encountered_objects;
+  TPrevRange        m_prev;
+  const TPredicate* m_predicate{};
 };
 
 // ----------------------------------
-// select
+// append
 // ----------------------------------
 
-// Resolves the arguments that are passed to a select functor.
-template <typename TPrevRange>
-using select_transform_arg_t = std::add_const_t<std::add_lvalue_reference_t<typename TPrevRange::iterator::output_t>>;
-
-// Resolves the return type of a select functor.
-template <typename TPrevRange, typename TTransform>
-using select_output_t = std::invoke_result_t<TTransform, select_transform_arg_t<TPrevRange>>;
-
-template <typename TPrevRange, typename TTransform>
-class select_range : public base_range<select_range<TPrevRange, TTransform>, select_output_t<TPrevRange, TTransform>> {
+template <typename TPrevRange, typename TOtherRange>
+class append_range : public base_range<append_range<TPrevRange, TOtherRange>, typename TPrevRange::iterator::output_t> {
 public:
+  using other_range_iter_t = typename TOtherRange::iterator;
+
   struct iterator {
     using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = select_output_t<TPrevRange, TTransform>;
+    using output_t    = typename prev_iter_t::output_t;
 
-    iterator(const select_range* parent, prev_iter_t begin, prev_iter_t end)
-        : m_parent(parent)
-        , m_begin(begin)
-        , m_end(end) {
+    iterator(prev_iter_t begin, prev_iter_t end, other_range_iter_t other_begin, other_range_iter_t other_end)
+        : m_my_begin(begin)
+        , m_my_end(end)
+        , m_other_begin(other_begin)
+        , m_other_end(other_end) {
     }
 
     bool operator==(const iterator& o) const {
-      return m_begin == o.m_begin;
+      return m_other_begin == o.m_other_begin;
     }
 
     bool operator!=(const iterator& o) const {
-      return m_begin != o.m_begin;
+      return m_other_begin != o.m_other_begin;
     }
 
     iterator& operator++() {
-      ++m_begin;
+      if (m_my_begin != m_my_end) {
+        ++m_my_begin;
+      }
+      else {
+        ++m_other_begin;
+      }
+
       return *this;
     }
 
-    output_t operator*() const {
-      return m_parent->m_transform(*m_begin);
+    decltype(auto) operator*() const {
+      return m_my_begin != m_my_end ? *m_my_begin : *m_other_begin;
     }
 
-    const select_range* m_parent;
-    prev_iter_t         m_begin;
-    prev_iter_t         m_end;
+    prev_iter_t        m_my_begin;
+    prev_iter_t        m_my_end;
+    other_range_iter_t m_other_begin;
+    other_range_iter_t m_other_end;
   };
 
-  select_range(const TPrevRange& prev, TTransform transform)
+  append_range(const TPrevRange& prev, const TOtherRange& other_range)
       : m_prev(prev)
-      , m_transform(std::move(transform)) {
+      , m_other_range(other_range) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements || TOtherRange::holds_elements;
+
   iterator begin() const {
-    return iterator(this, m_prev.begin(), m_prev.end());
+    return iterator(m_prev.begin(), m_prev.end(), m_other_range.begin(), m_other_range.end());
   }
 
   iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator(this, prev_end, prev_end);
+    const auto prev_end  = m_prev.end();
+    const auto other_end = m_other_range.end();
+    return iterator(prev_end, prev_end, other_end, other_end);
   }
 
-private:
-  TPrevRange m_prev;
-  TTransform m_transform{};
+private:
+  TPrevRange  m_prev;
+  TOtherRange m_other_range;
 };
 
 // ----------------------------------
-// select_to_string
+// repeat
 // ----------------------------------
 
 template <typename TPrevRange>
-class select_to_string_range : public base_range<select_to_string_range<TPrevRange>, std::string> {
+class repeat_range : public base_range<repeat_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
 public:
   struct iterator {
     using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = std::string;
+    using output_t    = typename prev_iter_t::output_t;
 
-    iterator(const select_to_string_range* parent, prev_iter_t begin, prev_iter_t end)
-        : m_parent(parent)
-        , m_begin(begin)
-        , m_end(end) {
+    iterator(TPrevRange* prev_range_ptr, prev_iter_t begin, prev_iter_t end, size_t count)
+        : m_prev_range_ptr(prev_range_ptr)
+        , m_pos(begin)
+        , m_end(end)
+        , m_count(count) {
     }
 
     bool operator==(const iterator& o) const {
-      return m_begin == o.m_begin;
+      return m_pos == o.m_pos;
     }
 
     bool operator!=(const iterator& o) const {
-      return m_begin != o.m_begin;
+      return m_pos != o.m_pos;
     }
 
     iterator& operator++() {
-      ++m_begin;
+      ++m_pos;
+
+      if (m_pos == m_end && m_count > 0) {
+        m_pos = m_prev_range_ptr->begin();
+        --m_count;
+      }
+
       return *this;
     }
 
-    output_t operator*() const {
-      return std::to_string(*m_begin);
+    decltype(auto) operator*() const {
+      return *m_pos;
     }
 
-    const select_to_string_range* m_parent{};
-    prev_iter_t                   m_begin;
-    prev_iter_t                   m_end;
+    TPrevRange* m_prev_range_ptr{};
+    prev_iter_t m_pos{};
+    prev_iter_t m_end{};
+    size_t      m_count{};
   };
 
-  explicit select_to_string_range(const TPrevRange& prev)
-      : m_prev(prev) {
+  repeat_range(const TPrevRange& prev, size_t count)
+      : m_prev(prev)
+      , m_count(count) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator{this, m_prev.begin(), m_prev.end()};
+    return iterator(&m_prev, m_prev.begin(), m_prev.end(), m_count);
   }
 
   iterator end() const {
     const auto prev_end = m_prev.end();
-    return iterator{this, prev_end, prev_end};
+    return iterator(&m_prev, prev_end, prev_end, 0);
   }
 
 private:
-  TPrevRange m_prev;
+  mutable TPrevRange m_prev;
+  size_t             m_count;
 };
 
 // ----------------------------------
-// select_many
+// chunk
 // ----------------------------------
 
-template <typename TPrevRange, typename TTransform>
-struct select_many_traits {
-  using returned_range_t = std::invoke_result_t<TTransform, typename TPrevRange::iterator::output_t>;
+template <typename TPrevRange, typename TAllocator>
+class chunk_range : public base_range<chunk_range<TPrevRange, TAllocator>,
+                                      chunk_view<std::decay_t<typename TPrevRange::iterator::output_t>>> {
+public:
+  using element_t = std::decay_t<typename TPrevRange::iterator::output_t>;
+  using buffer_t  = typename scratch_buffer<element_t, TAllocator>::container_t;
 
-  // See if the returned type is really a range.
-  static_assert(std::is_base_of_v<base_range_ident, returned_range_t>,
-                "The transform function of select_many is expected to return a LINQ range.");
+  // Views the source directly.
+  struct contiguous_iterator {
+    using output_t = chunk_view<element_t>;
 
-  using output_t = typename returned_range_t::iterator::output_t;
-};
+    contiguous_iterator(const element_t* pos, const element_t* end, size_t size)
+        : m_pos(pos)
+        , m_end(end)
+        , m_size(size) {
+    }
 
-template <typename TPrevRange, typename TTransform>
-class select_many_range : public base_range<select_many_range<TPrevRange, TTransform>,
-                                            typename select_many_traits<TPrevRange, TTransform>::output_t> {
-public:
-  struct iterator {
-    using prev_iter_t = typename TPrevRange::iterator;
+    bool operator==(const contiguous_iterator& o) const {
+      return m_pos == o.m_pos;
+    }
 
-    using returned_range_t      = typename select_many_traits<TPrevRange, TTransform>::returned_range_t;
-    using returned_range_iter_t = typename returned_range_t::iterator;
-    using output_t              = typename returned_range_iter_t::output_t;
+    bool operator!=(const contiguous_iterator& o) const {
+      return m_pos != o.m_pos;
+    }
 
-    iterator(const select_many_range* parent, prev_iter_t pos, prev_iter_t end)
-        : m_parent(parent)
-        , m_pos(std::move(pos))
-        , m_end(std::move(end)) {
-      if (m_pos != m_end) {
-        const auto& transform = m_parent->m_transform;
-        bool        first     = true;
+    contiguous_iterator& operator++() {
+      m_pos += current_size();
+      return *this;
+    }
 
-        do {
-          if (!first) {
-            ++m_pos;
-          }
+    output_t operator*() const {
+      return output_t{m_pos, current_size()};
+    }
 
-          if (m_pos == m_end) {
-            break;
-          }
+    size_t current_size() const {
+      return std::min(m_size, static_cast<size_t>(m_end - m_pos));
+    }
+
+    const element_t* m_pos;
+    const element_t* m_end;
+    size_t           m_size{};
+  };
 
-          m_ret_range = transform(*m_pos);
-          m_ret_begin = m_ret_range.begin();
-          m_ret_end   = m_ret_range.end();
+  // Copies the elements of every chunk into a reused buffer.
+  struct buffered_iterator {
+    using prev_iter_t = typename TPrevRange::iterator;
+    using output_t    = chunk_view<element_t>;
 
-          first = false;
-        } while (m_ret_begin == m_ret_end);
+    buffered_iterator(prev_iter_t pos, prev_iter_t end, size_t size, buffer_t* buffer, bool is_end)
+        : m_pos(pos)
+        , m_end(end)
+        , m_size(size)
+        , m_buffer(buffer)
+        , m_index(is_end ? end_index : 0) {
+      if (!is_end) {
+        fill();
       }
     }
 
-    bool operator==(const iterator& o) const {
-      return m_pos == o.m_pos;
+    bool operator==(const buffered_iterator& o) const {
+      return m_index == o.m_index;
     }
 
-    bool operator!=(const iterator& o) const {
-      return m_pos != o.m_pos;
+    bool operator!=(const buffered_iterator& o) const {
+      return m_index != o.m_index;
     }
 
-    iterator& operator++() {
-      if (m_ret_begin != m_ret_end) {
-        // There are values left to be obtained from the returned range.
-        ++m_ret_begin;
-      }
+    buffered_iterator& operator++() {
+      ++m_index;
+      fill();
+      return *this;
+    }
 
-      if (m_ret_begin == m_ret_end) {
-        // Move our parent iterator forward to get the next container.
-        ++m_pos;
+    output_t operator*() const {
+      return output_t{m_buffer->data(), m_buffer->size()};
+    }
 
-        if (m_pos != m_end) {
-          m_ret_range = m_parent->m_transform(*m_pos);
-          m_ret_begin = m_ret_range.begin();
-          m_ret_end   = m_ret_range.end();
-        }
-      }
+    void fill() {
+      m_buffer->clear();
 
-      return *this;
-    }
+      while (m_pos != m_end && m_buffer->size() < m_size) {
+        m_buffer->push_back(*m_pos);
+        ++m_pos;
+      }
 
-    const output_t& operator*() const {
-      return *m_ret_begin;
+      if (m_buffer->empty()) {
+        m_index = end_index;
+      }
     }
 
-    const select_many_range* m_parent;
-    prev_iter_t              m_pos;
-    prev_iter_t              m_end;
+    static constexpr size_t end_index = static_cast<size_t>(-1);
 
-    returned_range_t      m_ret_range;
-    returned_range_iter_t m_ret_begin;
-    returned_range_iter_t m_ret_end;
+    prev_iter_t m_pos;
+    prev_iter_t m_end;
+    size_t      m_size{};
+    buffer_t*   m_buffer{};
+    size_t      m_index{};
   };
 
-  select_many_range() = default;
+  using iterator = std::conditional_t<TPrevRange::is_contiguous, contiguous_iterator, buffered_iterator>;
 
-  select_many_range(const TPrevRange& prev, TTransform transform)
+  chunk_range(const TPrevRange& prev, size_t size, const TAllocator& allocator = TAllocator())
       : m_prev(prev)
-      , m_transform(std::move(transform)) {
+      , m_size(size)
+      , m_buffer(allocator) {
+    if (size == 0) {
+      throw std::invalid_argument("chunk size must be greater than zero");
+    }
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator{this, m_prev.begin(), m_prev.end()};
+    if constexpr (TPrevRange::is_contiguous) {
+      const element_t* data = m_prev.data();
+      return iterator(data, data + m_prev.slice_count(), m_size);
+    }
+    else {
+      if constexpr (TPrevRange::is_indexed) {
+        // A chunk can't be larger than the range. Otherwise, the buffer grows as elements arrive.
+        m_buffer.values().reserve(std::min(m_size, m_prev.slice_count()));
+      }
+
+      return iterator(m_prev.begin(), m_prev.end(), m_size, std::addressof(m_buffer.values()), false);
+    }
   }
 
   iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator{this, prev_end, prev_end};
+    if constexpr (TPrevRange::is_contiguous) {
+      const element_t* data_end = m_prev.data() + m_prev.slice_count();
+      return iterator(data_end, data_end, m_size);
+    }
+    else {
+      const auto prev_end = m_prev.end();
+      return iterator(prev_end, prev_end, m_size, std::addressof(m_buffer.values()), true);
+    }
   }
 
 private:
-  TPrevRange m_prev;
-  TTransform m_transform;
+  TPrevRange                                    m_prev;
+  size_t                                        m_size{};
+  mutable scratch_buffer<element_t, TAllocator> m_buffer;
 };
 
 // ----------------------------------
-// reverse
+// zip
 // ----------------------------------
 
-template <typename TPrevRange>
-class reverse_range : public base_range<reverse_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
+// The transform of zip(): packs the elements of all ranges into a tuple, keeping references to
+// elements that are yielded by reference. If any of the ranges stores its elements (see holds_elements),
+// the elements are copied instead, because the zip range holds copies of the ranges that may be
+// temporaries, e.g. in from({1, 2}).zip(from({3, 4})).to_vector().
+template <bool CopyElements>
+struct zip_tuple_transform {
+  template <typename... TElements>
+  auto operator()(TElements&&... elements) const {
+    if constexpr (CopyElements) {
+      return std::tuple<std::decay_t<TElements>...>(std::forward<TElements>(elements)...);
+    }
+    else {
+      return std::tuple<TElements...>(std::forward<TElements>(elements)...);
+    }
+  }
+};
+
+// Resolves the return type of a zip transform.
+template <typename TTransform, typename... TRanges>
+using zip_output_t = std::invoke_result_t<TTransform, typename TRanges::iterator::output_t...>;
+
+template <typename TTransform, typename... TRanges>
+class zip_range : public base_range<zip_range<TTransform, TRanges...>, zip_output_t<TTransform, TRanges...>> {
 public:
-  using prev_iter_t      = typename TPrevRange::iterator;
-  using object_container = std::vector<prev_iter_t>;
+  using output_t = zip_output_t<TTransform, TRanges...>;
 
-  struct iterator {
-    using output_t = typename prev_iter_t::output_t;
+  // Steps the iterators of all ranges.
+  struct stepping_iterator {
+    using iterators_t = std::tuple<typename TRanges::iterator...>;
+    using output_t    = zip_output_t<TTransform, TRanges...>;
 
-    iterator(const object_container* prev_iterators, size_t index)
-        : m_prev_iterators(prev_iterators)
-        , m_index(index) {
+    stepping_iterator(const zip_range* parent, iterators_t positions)
+        : m_parent(parent)
+        , m_positions(std::move(positions)) {
     }
 
-    bool operator==(const iterator& o) const {
-      return m_index == o.m_index;
+    // Iterators are equal as soon as any of the ranges is at the same position,
+    // so that iteration stops at the end of the shortest range.
+    bool operator==(const stepping_iterator& o) const {
+      return any_equal(o, std::index_sequence_for<TRanges...>{});
     }
 
-    bool operator!=(const iterator& o) const {
-      return m_index != o.m_index;
+    bool operator!=(const stepping_iterator& o) const {
+      return !(*this == o);
     }
 
-    iterator& operator++() {
-      --m_index;
+    stepping_iterator& operator++() {
+      std::apply([](auto&... positions) { (++positions, ...); }, m_positions);
       return *this;
     }
 
-    const output_t& operator*() const {
-      return *(*m_prev_iterators)[m_index];
+    output_t operator*() const {
+      return std::apply([this](const auto&... positions) { return m_parent->m_transform(*positions...); },
+                        m_positions);
     }
 
-    const object_container* m_prev_iterators;
-    size_t                  m_index{};
-  };
-
-  reverse_range() = default;
-
-  explicit reverse_range(const TPrevRange& prev)
-      : m_prev(prev) {
-  }
-
-  iterator begin() const {
-    m_prev_iterators.clear();
-
-    for (auto beg = m_prev.begin(), end = m_prev.end(); beg != end; ++beg) {
-      m_prev_iterators.push_back(beg);
+    template <size_t... Indices>
+    bool any_equal(const stepping_iterator& o, std::index_sequence<Indices...>) const {
+      return ((std::get<Indices>(m_positions) == std::get<Indices>(o.m_positions)) || ...);
     }
 
-    return iterator{std::addressof(m_prev_iterators), m_prev_iterators.size() - 1};
-  }
-
-  iterator end() const {
-    return iterator{nullptr, static_cast<size_t>(-1)};
-  }
-
-private:
-  TPrevRange               m_prev;
-  mutable object_container m_prev_iterators;
-};
-
-// ----------------------------------
-// take
-// ----------------------------------
+    const zip_range* m_parent;
+    iterators_t      m_positions;
+  };
 
-template <typename TPrevRange>
-class take_range : public base_range<take_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
-public:
-  struct iterator {
-    using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+  // Computes elements by index; used when all ranges are indexed.
+  struct indexed_iterator {
+    using output_t = zip_output_t<TTransform, TRanges...>;
 
-    iterator(prev_iter_t begin, size_t count)
-        : m_begin(begin)
-        , m_count(count) {
+    indexed_iterator(const zip_range* parent, size_t index)
+        : m_parent(parent)
+        , m_index(index) {
     }
 
-    bool operator==(const iterator& o) const {
-      return m_count == o.m_count || m_begin == o.m_begin;
+    bool operator==(const indexed_iterator& o) const {
+      return m_index == o.m_index;
     }
 
-    bool operator!=(const iterator& o) const {
-      return m_count != o.m_count && m_begin != o.m_begin;
+    bool operator!=(const indexed_iterator& o) const {
+      return m_index != o.m_index;
     }
 
-    iterator& operator++() {
-      ++m_begin;
-      --m_count;
+    indexed_iterator& operator++() {
+      ++m_index;
       return *this;
     }
 
-    const output_t& operator*() const {
-      return *m_begin;
+    output_t operator*() const {
+      return m_parent->at(m_index);
     }
 
-    prev_iter_t m_begin;
-    size_t      m_count{};
+    const zip_range* m_parent;
+    size_t           m_index{};
   };
 
-  take_range() = default;
+  static constexpr bool is_indexed   = (TRanges::is_indexed && ...);
+  static constexpr bool is_sliceable = is_indexed;
 
-  take_range(const TPrevRange& prev, size_t count)
-      : m_prev(prev)
-      , m_count(count) {
+  using iterator = std::conditional_t<is_indexed, indexed_iterator, stepping_iterator>;
+
+  zip_range(TTransform transform, const TRanges&... ranges)
+      : m_ranges(ranges...)
+      , m_transform(std::move(transform)) {
   }
 
+  static constexpr bool holds_elements = (TRanges::holds_elements || ...);
+
   iterator begin() const {
-    return iterator(m_prev.begin(), m_count);
+    if constexpr (is_indexed) {
+      return iterator(this, 0);
+    }
+    else {
+      return iterator(this, std::apply([](const auto&... ranges) { return std::tuple{ranges.begin()...}; }, m_ranges));
+    }
   }
 
   iterator end() const {
-    return iterator(m_prev.end(), 0);
+    if constexpr (is_indexed) {
+      return iterator(this, slice_count());
+    }
+    else {
+      return iterator(this, std::apply([](const auto&... ranges) { return std::tuple{ranges.end()...}; }, m_ranges));
+    }
+  }
+
+  size_t slice_count() const {
+    return std::apply([](const auto&... ranges) { return std::min({ranges.slice_count()...}); }, m_ranges);
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator(this, first), iterator(this, last)};
+  }
+
+  output_t at(size_t index) const {
+    return std::apply([this, index](const auto&... ranges) { return m_transform(ranges.at(index)...); }, m_ranges);
   }
 
 private:
-  TPrevRange m_prev;
-  size_t     m_count{};
+  std::tuple<TRanges...> m_ranges;
+  TTransform             m_transform;
 };
 
 // ----------------------------------
-// take_while
+// scan
 // ----------------------------------
 
-template <typename TPrevRange, typename TPredicate>
-class take_while_range
-    : public base_range<take_while_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
+template <typename TPrevRange, typename TOperation, typename TAccum, bool Inclusive>
+class scan_range : public base_range<scan_range<TPrevRange, TOperation, TAccum, Inclusive>, TAccum> {
 public:
   struct iterator {
     using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+    using output_t    = TAccum;
 
-    iterator(const take_while_range* parent, prev_iter_t begin, prev_iter_t end)
+    iterator(const scan_range* parent, prev_iter_t begin, prev_iter_t end)
         : m_parent(parent)
         , m_begin(begin)
         , m_end(end) {
-      const auto& pred = m_parent->m_predicate;
-
-      if (m_begin != m_end && !pred(*m_begin)) {
-        m_begin = m_end;
+      if (m_begin != m_end) {
+        if constexpr (Inclusive) {
+          m_value.emplace(*m_begin);
+        }
+        else {
+          m_value.emplace(m_parent->m_init);
+        }
       }
     }
 
@@ -830,296 +3918,577 @@ public:
     }
 
     iterator& operator++() {
-      ++m_begin;
-
-      const auto& pred = m_parent->m_predicate;
+      const auto& operation = m_parent->m_operation;
 
-      if (m_begin != m_end && !pred(*m_begin)) {
-        m_begin = m_end;
+      if constexpr (Inclusive) {
+        ++m_begin;
+
+        if (m_begin != m_end) {
+          m_value.emplace(operation(*m_value, *m_begin));
+        }
+      }
+      else {
+        m_value.emplace(operation(*m_value, *m_begin));
+        ++m_begin;
       }
 
       return *this;
     }
 
     const output_t& operator*() const {
-      return *m_begin;
+      return *m_value;
     }
 
-    const take_while_range* m_parent;
+    const scan_range*       m_parent;
     prev_iter_t             m_begin;
     prev_iter_t             m_end;
+    std::optional<output_t> m_value;
   };
 
-  take_while_range() = default;
-
-  take_while_range(const TPrevRange& prev, TPredicate predicate)
+  scan_range(const TPrevRange& prev, TOperation operation, TAccum init = {})
       : m_prev(prev)
-      , m_predicate(std::move(predicate)) {
+      , m_operation(std::move(operation))
+      , m_init(std::move(init)) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
     return iterator(this, m_prev.begin(), m_prev.end());
   }
 
   iterator end() const {
-    return iterator(this, m_prev.end(), m_prev.end());
+    const auto prev_end = m_prev.end();
+    return iterator(this, prev_end, prev_end);
   }
 
 private:
   TPrevRange m_prev;
-  TPredicate m_predicate;
+  TOperation m_operation;
+  TAccum     m_init;
 };
 
 // ----------------------------------
-// skip
+// window
 // ----------------------------------
 
-template <typename TPrevRange>
-class skip_range : public base_range<skip_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
+template <typename TPrevRange, typename TAllocator>
+class window_range : public base_range<window_range<TPrevRange, TAllocator>,
+                                       chunk_view<std::decay_t<typename TPrevRange::iterator::output_t>>> {
 public:
-  struct iterator {
+  using element_t = std::decay_t<typename TPrevRange::iterator::output_t>;
+  using buffer_t  = typename scratch_buffer<element_t, TAllocator>::container_t;
+
+  // Views the source directly.
+  struct contiguous_iterator {
+    using output_t = chunk_view<element_t>;
+
+    contiguous_iterator(const element_t* pos, size_t size)
+        : m_pos(pos)
+        , m_size(size) {
+    }
+
+    bool operator==(const contiguous_iterator& o) const {
+      return m_pos == o.m_pos;
+    }
+
+    bool operator!=(const contiguous_iterator& o) const {
+      return m_pos != o.m_pos;
+    }
+
+    contiguous_iterator& operator++() {
+      ++m_pos;
+      return *this;
+    }
+
+    output_t operator*() const {
+      return output_t{m_pos, m_size};
+    }
+
+    const element_t* m_pos;
+    size_t           m_size{};
+  };
+
+  // Keeps the window in a buffer of twice the window size. Once the buffer is full,
+  // the current window is moved to its front, so that every element is moved at most once.
+  struct buffered_iterator {
     using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+    using output_t    = chunk_view<element_t>;
 
-    iterator(prev_iter_t begin, prev_iter_t end, size_t count)
-        : m_begin(begin) {
-      while (m_begin != end && count > 0) {
-        ++m_begin;
-        --count;
+    buffered_iterator(prev_iter_t pos, prev_iter_t end, size_t size, buffer_t* buffer, bool is_end)
+        : m_pos(pos)
+        , m_end(end)
+        , m_size(size)
+        , m_buffer(buffer)
+        , m_index(is_end ? end_index : 0) {
+      if (!is_end) {
+        m_buffer->clear();
+
+        while (m_pos != m_end && m_buffer->size() < m_size) {
+          m_buffer->push_back(*m_pos);
+          ++m_pos;
+        }
+
+        if (m_buffer->size() < m_size) {
+          m_index = end_index;
+        }
       }
     }
 
-    bool operator==(const iterator& o) const {
-      return m_begin == o.m_begin;
+    bool operator==(const buffered_iterator& o) const {
+      return m_index == o.m_index;
     }
 
-    bool operator!=(const iterator& o) const {
-      return m_begin != o.m_begin;
+    bool operator!=(const buffered_iterator& o) const {
+      return m_index != o.m_index;
     }
 
-    iterator& operator++() {
-      ++m_begin;
+    buffered_iterator& operator++() {
+      if (m_pos == m_end) {
+        m_index = end_index;
+        return *this;
+      }
+
+      // The buffer is full once it holds two windows (written this way so that 2 * size can't overflow).
+      // Only the last size - 1 elements are kept, since the next window shares them.
+      if (m_buffer->size() - m_size == m_size) {
+        m_buffer->erase(m_buffer->begin(), m_buffer->end() - static_cast<std::ptrdiff_t>(m_size - 1));
+      }
+
+      m_buffer->push_back(*m_pos);
+      ++m_pos;
+      ++m_index;
+
       return *this;
     }
 
-    const output_t& operator*() const {
-      return *m_begin;
+    output_t operator*() const {
+      return output_t{m_buffer->data() + (m_buffer->size() - m_size), m_size};
     }
 
-    prev_iter_t m_begin;
+    static constexpr size_t end_index = static_cast<size_t>(-1);
+
+    prev_iter_t m_pos;
+    prev_iter_t m_end;
+    size_t      m_size{};
+    buffer_t*   m_buffer{};
+    size_t      m_index{};
   };
 
-  skip_range(const TPrevRange& prev, size_t count)
+  using iterator = std::conditional_t<TPrevRange::is_contiguous, contiguous_iterator, buffered_iterator>;
+
+  window_range(const TPrevRange& prev, size_t size, const TAllocator& allocator = TAllocator())
       : m_prev(prev)
-      , m_count(count) {
+      , m_size(size)
+      , m_buffer(allocator) {
+    if (size == 0) {
+      throw std::invalid_argument("window size must be greater than zero");
+    }
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator(m_prev.begin(), m_prev.end(), m_count);
+    if constexpr (TPrevRange::is_contiguous) {
+      return m_prev.slice_count() < m_size ? end() : iterator(m_prev.data(), m_size);
+    }
+    else {
+      if constexpr (TPrevRange::is_indexed) {
+        // Room for two windows, which can't be larger than the range. Otherwise, the buffer grows as
+        // elements arrive.
+        const size_t window_size = std::min(m_size, m_prev.slice_count());
+        m_buffer.values().reserve(window_size <= m_buffer.values().max_size() / 2 ? 2 * window_size : window_size);
+      }
+
+      return iterator(m_prev.begin(), m_prev.end(), m_size, std::addressof(m_buffer.values()), false);
+    }
   }
 
   iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator(prev_end, prev_end, 0);
+    if constexpr (TPrevRange::is_contiguous) {
+      const size_t count = m_prev.slice_count();
+      return iterator(m_prev.data() + (count < m_size ? 0 : count - m_size + 1), m_size);
+    }
+    else {
+      const auto prev_end = m_prev.end();
+      return iterator(prev_end, prev_end, m_size, std::addressof(m_buffer.values()), true);
+    }
   }
 
 private:
-  TPrevRange m_prev;
-  size_t     m_count{};
+  TPrevRange                                    m_prev;
+  size_t                                        m_size{};
+  mutable scratch_buffer<element_t, TAllocator> m_buffer;
 };
 
 // ----------------------------------
-// skip_while
+// window_aggregate
 // ----------------------------------
 
-template <typename TPrevRange, typename TPredicate>
-class skip_while_range
-    : public base_range<skip_while_range<TPrevRange, TPredicate>, typename TPrevRange::iterator::output_t> {
+template <typename T>
+class rolling_sum_aggregator {
 public:
-  struct iterator {
-    using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+  void push(const T& entering) {
+    m_sum += entering;
+  }
 
-    iterator(prev_iter_t begin, prev_iter_t end, const TPredicate& predicate)
-        : m_begin(begin) {
-      while (m_begin != end && predicate(*m_begin)) {
-        ++m_begin;
-      }
-    }
+  void pop(const T& leaving) {
+    m_sum -= leaving;
+  }
 
-    bool operator==(const iterator& o) const {
-      return m_begin == o.m_begin;
-    }
-    bool operator!=(const iterator& o) const {
-      return m_begin != o.m_begin;
-    }
+  const T& result() const {
+    return m_sum;
+  }
 
-    iterator& operator++() {
-      ++m_begin;
-      return *this;
-    }
+private:
+  T m_sum{};
+};
 
-    const output_t& operator*() const {
-      return *m_begin;
-    }
+template <typename T>
+class rolling_average_aggregator {
+public:
+  using result_t = std::conditional_t<std::is_arithmetic_v<T>, long double, T>;
 
-    prev_iter_t m_begin;
-  };
+  void push(const T& entering) {
+    m_sum += entering;
+    ++m_count;
+  }
 
-  skip_while_range(const TPrevRange& prev, const TPredicate& predicate)
-      : m_prev(prev)
-      , m_predicate(&predicate) {
+  void pop(const T& leaving) {
+    m_sum -= leaving;
+    --m_count;
   }
 
-  iterator begin() const {
-    return iterator(m_prev.begin(), m_prev.end(), *m_predicate);
+  result_t result() const {
+    return static_cast<result_t>(m_sum) / m_count;
   }
 
-  iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator(prev_end, prev_end, *m_predicate);
+private:
+  T      m_sum{};
+  size_t m_count{};
+};
+
+// Keeps the candidates for the extreme of the window in a deque, ordered by age.
+// A candidate is dropped as soon as a newer element is at least as extreme, since it can't
+// become the extreme of any later window. The front of the deque is the extreme of the window.
+template <typename T, typename TCompare, typename TAllocator = std::allocator<std::byte>>
+class rolling_extreme_aggregator {
+public:
+  explicit rolling_extreme_aggregator(const TAllocator& allocator = TAllocator())
+      : m_candidates(rebind_alloc_t<TAllocator, T>(allocator)) {
+  }
+
+  // Keeps the allocator, which copying the deque would replace by
+  // select_on_container_copy_construction.
+  rolling_extreme_aggregator(const rolling_extreme_aggregator& copy_from)
+      : m_candidates(copy_from.m_candidates, copy_from.m_candidates.get_allocator()) {
+  }
+
+  rolling_extreme_aggregator& operator=(const rolling_extreme_aggregator&) = default;
+
+  void push(const T& entering) {
+    while (!m_candidates.empty() && TCompare{}(entering, m_candidates.back())) {
+      m_candidates.pop_back();
+    }
+
+    m_candidates.push_back(entering);
+  }
+
+  void pop(const T& leaving) {
+    if (!TCompare{}(m_candidates.front(), leaving) && !TCompare{}(leaving, m_candidates.front())) {
+      m_candidates.pop_front();
+    }
+  }
+
+  const T& result() const {
+    return m_candidates.front();
   }
 
 private:
-  TPrevRange        m_prev;
-  const TPredicate* m_predicate{};
+  std::deque<T, rebind_alloc_t<TAllocator, T>> m_candidates;
 };
 
-// ----------------------------------
-// append
-// ----------------------------------
+// Maps an aggregation to the type that aggregates elements of type T.
+template <typename TAggregation, typename T, typename TAllocator>
+struct window_aggregator {
+  using type = TAggregation;
+};
 
-template <typename TPrevRange, typename TOtherRange>
-class append_range : public base_range<append_range<TPrevRange, TOtherRange>, typename TPrevRange::iterator::output_t> {
+template <typename T, typename TAllocator>
+struct window_aggregator<rolling_sum, T, TAllocator> {
+  using type = rolling_sum_aggregator<T>;
+};
+
+template <typename T, typename TAllocator>
+struct window_aggregator<rolling_average, T, TAllocator> {
+  using type = rolling_average_aggregator<T>;
+};
+
+template <typename T, typename TAllocator>
+struct window_aggregator<rolling_min, T, TAllocator> {
+  using type = rolling_extreme_aggregator<T, std::less<>, TAllocator>;
+};
+
+template <typename T, typename TAllocator>
+struct window_aggregator<rolling_max, T, TAllocator> {
+  using type = rolling_extreme_aggregator<T, std::greater<>, TAllocator>;
+};
+
+template <typename TPrevRange, typename TAggregator>
+using window_aggregate_output_t = std::decay_t<decltype(std::declval<const TAggregator&>().result())>;
+
+template <typename TPrevRange, typename TAggregator, typename TAllocator>
+class window_aggregate_range : public base_range<window_aggregate_range<TPrevRange, TAggregator, TAllocator>,
+                                                 window_aggregate_output_t<TPrevRange, TAggregator>> {
 public:
-  using other_range_iter_t = typename TOtherRange::iterator;
+  using element_t = std::decay_t<typename TPrevRange::iterator::output_t>;
+  using window_t  = std::vector<element_t, rebind_alloc_t<TAllocator, element_t>>;
 
   struct iterator {
     using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+    using output_t    = window_aggregate_output_t<TPrevRange, TAggregator>;
 
-    iterator(prev_iter_t begin, prev_iter_t end, other_range_iter_t other_begin, other_range_iter_t other_end)
-        : m_my_begin(begin)
-        , m_my_end(end)
-        , m_other_begin(other_begin)
-        , m_other_end(other_end) {
+    iterator(const window_aggregate_range* parent, prev_iter_t pos, prev_iter_t end, bool is_end)
+        : m_pos(pos)
+        , m_end(end)
+        , m_index(is_end ? end_index : 0)
+        , m_window(rebind_alloc_t<TAllocator, element_t>(parent->m_allocator))
+        , m_aggregator(parent->m_aggregator) {
+      if (is_end) {
+        return;
+      }
+
+      const size_t size = parent->m_size;
+
+      if constexpr (TPrevRange::is_indexed) {
+        // The window can't be larger than the range. Otherwise, it grows as elements arrive.
+        m_window.reserve(std::min(size, parent->m_prev.slice_count()));
+      }
+
+      while (m_pos != m_end && m_window.size() < size) {
+        m_window.push_back(*m_pos);
+        m_aggregator.push(m_window.back());
+        ++m_pos;
+      }
+
+      if (m_window.size() < size) {
+        m_index = end_index;
+      }
+      else {
+        m_result.emplace(m_aggregator.result());
+      }
     }
 
     bool operator==(const iterator& o) const {
-      return m_other_begin == o.m_other_begin;
+      return m_index == o.m_index;
     }
 
     bool operator!=(const iterator& o) const {
-      return m_other_begin != o.m_other_begin;
+      return m_index != o.m_index;
     }
 
     iterator& operator++() {
-      if (m_my_begin != m_my_end) {
-        ++m_my_begin;
-      }
-      else {
-        ++m_other_begin;
+      if (m_pos == m_end) {
+        m_index = end_index;
+        return *this;
       }
 
+      // The window is a ring buffer; the oldest element is at m_oldest.
+      auto& slot = m_window[m_oldest];
+
+      m_aggregator.pop(slot);
+      slot = *m_pos;
+      m_aggregator.push(slot);
+      m_result.emplace(m_aggregator.result());
+
+      m_oldest = (m_oldest + 1) % m_window.size();
+      ++m_pos;
+      ++m_index;
+
       return *this;
     }
 
     const output_t& operator*() const {
-      return m_my_begin != m_my_end ? *m_my_begin : *m_other_begin;
+      return *m_result;
     }
 
-    prev_iter_t        m_my_begin;
-    prev_iter_t        m_my_end;
-    other_range_iter_t m_other_begin;
-    other_range_iter_t m_other_end;
+    static constexpr size_t end_index = static_cast<size_t>(-1);
+
+    prev_iter_t             m_pos;
+    prev_iter_t             m_end;
+    size_t                  m_index{};
+    window_t                m_window;
+    size_t                  m_oldest{};
+    TAggregator             m_aggregator;
+    std::optional<output_t> m_result;
   };
 
-  append_range(const TPrevRange& prev, const TOtherRange& other_range)
+  window_aggregate_range(const TPrevRange& prev,
+                         size_t            size,
+                         TAggregator       aggregator,
+                         const TAllocator& allocator = TAllocator())
       : m_prev(prev)
-      , m_other_range(other_range) {
+      , m_size(size)
+      , m_aggregator(std::move(aggregator))
+      , m_allocator(allocator) {
+    if (size == 0) {
+      throw std::invalid_argument("window size must be greater than zero");
+    }
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator(m_prev.begin(), m_prev.end(), m_other_range.begin(), m_other_range.end());
+    return iterator(this, m_prev.begin(), m_prev.end(), false);
   }
 
   iterator end() const {
-    const auto prev_end  = m_prev.end();
-    const auto other_end = m_other_range.end();
-    return iterator(prev_end, prev_end, other_end, other_end);
+    const auto prev_end = m_prev.end();
+    return iterator(this, prev_end, prev_end, true);
   }
 
 private:
   TPrevRange  m_prev;
-  TOtherRange m_other_range;
+  size_t      m_size{};
+  TAggregator m_aggregator;
+  TAllocator  m_allocator;
 };
 
 // ----------------------------------
-// repeat
+// tee
 // ----------------------------------
 
-template <typename TPrevRange>
-class repeat_range : public base_range<repeat_range<TPrevRange>, typename TPrevRange::iterator::output_t> {
+// The upstream evaluation that is shared by all consumers of a tee.
+template <typename TPrevRange, typename TAllocator>
+class tee_state {
+public:
+  using prev_iter_t = typename TPrevRange::iterator;
+  using element_t   = std::decay_t<typename prev_iter_t::output_t>;
+
+  tee_state(const TPrevRange& prev, size_t consumer_count, const TAllocator& allocator)
+      : m_prev(prev)
+      , m_buffer(rebind_alloc_t<TAllocator, element_t>(allocator))
+      , m_positions(consumer_count, 0, rebind_alloc_t<TAllocator, size_t>(allocator)) {
+  }
+
+  tee_state(const tee_state&)            = delete;
+  tee_state& operator=(const tee_state&) = delete;
+
+  // Makes the element at the consumer's position available.
+  // Returns false if the upstream has no more elements.
+  bool fetch(size_t consumer) {
+    if (!m_pos) {
+      m_pos.emplace(m_prev.begin());
+      m_end.emplace(m_prev.end());
+    }
+
+    if (m_positions[consumer] < m_first_index + m_buffer.size()) {
+      return true;
+    }
+
+    if (*m_pos == *m_end) {
+      return false;
+    }
+
+    m_buffer.push_back(*(*m_pos));
+    ++(*m_pos);
+
+    return true;
+  }
+
+  const element_t& get(size_t consumer) const {
+    return m_buffer[m_positions[consumer] - m_first_index];
+  }
+
+  // Moves the consumer to the next element and drops the elements that no consumer needs anymore.
+  void advance(size_t consumer) {
+    const bool was_last = m_positions[consumer] == m_first_index;
+
+    ++m_positions[consumer];
+
+    if (was_last) {
+      const size_t slowest = *std::min_element(m_positions.begin(), m_positions.end());
+
+      while (m_first_index < slowest) {
+        m_buffer.pop_front();
+        ++m_first_index;
+      }
+    }
+  }
+
+private:
+  TPrevRange                                                   m_prev;
+  std::optional<prev_iter_t>                                   m_pos;
+  std::optional<prev_iter_t>                                   m_end;
+  std::deque<element_t, rebind_alloc_t<TAllocator, element_t>> m_buffer;
+  size_t                                                       m_first_index{};
+  std::vector<size_t, rebind_alloc_t<TAllocator, size_t>>      m_positions;
+};
+
+template <typename TPrevRange, typename TAllocator>
+class tee_range : public base_range<tee_range<TPrevRange, TAllocator>,
+                                    std::decay_t<typename TPrevRange::iterator::output_t>> {
 public:
+  using state_t = tee_state<TPrevRange, TAllocator>;
+
   struct iterator {
-    using prev_iter_t = typename TPrevRange::iterator;
-    using output_t    = typename prev_iter_t::output_t;
+    using output_t = typename state_t::element_t;
 
-    iterator(TPrevRange* prev_range_ptr, prev_iter_t begin, prev_iter_t end, size_t count)
-        : m_prev_range_ptr(prev_range_ptr)
-        , m_pos(begin)
-        , m_end(end)
-        , m_count(count) {
+    iterator(state_t* state, size_t consumer, bool is_end)
+        : m_state(state)
+        , m_consumer(consumer)
+        , m_is_end(is_end || !state->fetch(consumer)) {
     }
 
     bool operator==(const iterator& o) const {
-      return m_pos == o.m_pos;
+      return m_is_end == o.m_is_end;
     }
 
     bool operator!=(const iterator& o) const {
-      return m_pos != o.m_pos;
+      return m_is_end != o.m_is_end;
     }
 
     iterator& operator++() {
-      ++m_pos;
-
-      if (m_pos == m_end && m_count > 0) {
-        m_pos = m_prev_range_ptr->begin();
-        --m_count;
-      }
-
+      m_state->advance(m_consumer);
+      m_is_end = !m_state->fetch(m_consumer);
       return *this;
     }
 
     const output_t& operator*() const {
-      return *m_pos;
+      return m_state->get(m_consumer);
     }
 
-    TPrevRange* m_prev_range_ptr{};
-    prev_iter_t m_pos{};
-    prev_iter_t m_end{};
-    size_t      m_count{};
+    state_t* m_state;
+    size_t   m_consumer{};
+    bool     m_is_end{};
   };
 
-  repeat_range(const TPrevRange& prev, size_t count)
-      : m_prev(prev)
-      , m_count(count) {
+  tee_range(std::shared_ptr<state_t> state, size_t consumer)
+      : m_state(std::move(state))
+      , m_consumer(consumer) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements;
+
   iterator begin() const {
-    return iterator(&m_prev, m_prev.begin(), m_prev.end(), m_count);
+    return iterator(m_state.get(), m_consumer, false);
   }
 
   iterator end() const {
-    const auto prev_end = m_prev.end();
-    return iterator(&m_prev, prev_end, prev_end, 0);
+    return iterator(m_state.get(), m_consumer, true);
   }
 
 private:
-  mutable TPrevRange m_prev;
-  size_t             m_count;
+  std::shared_ptr<state_t> m_state;
+  size_t                   m_consumer{};
 };
 
+template <typename TPrevRange, typename TAllocator, size_t... Consumers>
+std::array<tee_range<TPrevRange, TAllocator>, sizeof...(Consumers)> make_tee_ranges(
+    const std::shared_ptr<tee_state<TPrevRange, TAllocator>>& state, std::index_sequence<Consumers...>) {
+  return {tee_range<TPrevRange, TAllocator>(state, Consumers)...};
+}
+
 // ----------------------------------
 // join
 // ----------------------------------
@@ -1235,6 +4604,8 @@ public:
       , m_transform(std::move(transform)) {
   }
 
+  static constexpr bool holds_elements = TPrevRange::holds_elements || TOtherRange::holds_elements;
+
   iterator begin() const {
     return iterator(m_prev.begin(), m_prev.end(), this);
   }
@@ -1256,17 +4627,31 @@ private:
 // order_by
 // ----------------------------------
 
-template <typename TPrevRange, typename TKeySelector>
+// Whether sorting operators buffer the addresses of a range's elements instead of copies.
+// That's the case if the elements live outside the range (the range yields references) and
+// are expensive to copy.
+template <typename TPrevRange>
+inline constexpr bool sorts_by_reference_v =
+    std::is_lvalue_reference_v<typename TPrevRange::iterator::output_t> &&
+    (!std::is_trivially_copyable_v<std::decay_t<typename TPrevRange::iterator::output_t>> ||
+     sizeof(std::decay_t<typename TPrevRange::iterator::output_t>) > 2 * sizeof(void*));
+
+template <typename TPrevRange, typename TKeySelector, typename TAllocator>
 class order_by_range
-    : public base_range<order_by_range<TPrevRange, TKeySelector>, typename TPrevRange::iterator::output_t>,
+    : public base_range<order_by_range<TPrevRange, TKeySelector, TAllocator>, typename TPrevRange::iterator::output_t>,
       public sorting_range {
 public:
+  using allocator_type      = TAllocator;
   using container_element_t = std::decay_t<typename TPrevRange::iterator::output_t>;
-  using container_t         = std::vector<container_element_t>;
+  using stored_t            = std::conditional_t<sorts_by_reference_v<TPrevRange>,
+                                                 const container_element_t*,
+                                                 container_element_t>;
+  using buffer_t            = scratch_buffer<stored_t, TAllocator>;
+  using container_t         = typename buffer_t::container_t;
   using container_iter_t    = typename container_t::const_iterator;
 
   struct iterator {
-    using output_t = typename container_iter_t::reference;
+    using output_t = const container_element_t&;
 
     explicit iterator(container_iter_t pos)
         : m_pos(pos) {
@@ -1286,34 +4671,71 @@ public:
     }
 
     output_t operator*() const {
-      return *m_pos;
+      return stored_value(*m_pos);
     }
 
     container_iter_t m_pos;
   };
 
-  order_by_range(const TPrevRange& prev, TKeySelector key_selector, sort_direction sort_dir)
+  static const container_element_t& stored_value(const stored_t& stored) {
+    if constexpr (sorts_by_reference_v<TPrevRange>) {
+      return *stored;
+    }
+    else {
+      return stored;
+    }
+  }
+
+  order_by_range(const TPrevRange&           prev,
+                 TKeySelector                key_selector,
+                 sort_direction              sort_dir,
+                 std::optional<executor_ref> executor  = {},
+                 const TAllocator&           allocator = TAllocator())
       : m_prev(prev)
       , m_key_selector(std::move(key_selector))
-      , m_sort_direction(sort_dir) {
+      , m_sort_direction(sort_dir)
+      , m_executor(executor)
+      , m_sorted_values(allocator)
+      , m_merge_buffer(allocator) {
   }
 
   iterator begin() const {
-    m_sorted_values.clear();
+    auto& sorted_values = m_sorted_values.values();
+    sorted_values.clear();
 
-    for (const auto& val : m_prev) {
-      m_sorted_values.push_back(val);
+    for (auto&& val : m_prev) {
+      if constexpr (sorts_by_reference_v<TPrevRange>) {
+        sorted_values.push_back(std::addressof(val));
+      }
+      else {
+        sorted_values.push_back(std::forward<decltype(val)>(val));
+      }
     }
 
-    std::stable_sort(m_sorted_values.begin(),
-                     m_sorted_values.end(),
-                     [this](const container_element_t& a, const container_element_t& b) { return compare_keys(a, b); });
+    const auto compare = [this](const stored_t& a, const stored_t& b) {
+      return compare_keys(stored_value(a), stored_value(b));
+    };
+
+    if (m_executor) {
+      parallel_stable_sort(*m_executor, sorted_values, m_merge_buffer.values(), compare);
+    }
+    else {
+      buffered_stable_sort(sorted_values, m_merge_buffer.values(), compare);
+    }
 
-    return iterator(m_sorted_values.begin());
+    return iterator(sorted_values.cbegin());
   }
 
   iterator end() const {
-    return iterator(m_sorted_values.end());
+    return iterator(m_sorted_values.values().cend());
+  }
+
+  static constexpr bool owns_elements  = !sorts_by_reference_v<TPrevRange>;
+  static constexpr bool holds_elements = owns_elements || TPrevRange::holds_elements;
+
+  container_t& owned_elements() {
+    (void)begin();
+    return m_sorted_values.values();
   }
 
   bool compare_keys(const container_element_t& a, const container_element_t& b) const {
@@ -1323,11 +4745,23 @@ public:
     return m_sort_direction == sort_direction::ascending ? /*ascending:*/ a_val < b_val : /*descending:*/ a_val > b_val;
   }
 
+  // The executor that sorts the elements, or none if they're sorted sequentially.
+  const std::optional<executor_ref>& executor() const {
+    return m_executor;
+  }
+
+  // The allocator of the sort buffer, which subsequent then_by operations share.
+  allocator_type get_allocator() const {
+    return m_sorted_values.get_allocator();
+  }
+
 private:
-  TPrevRange          m_prev;
-  TKeySelector        m_key_selector;
-  sort_direction      m_sort_direction;
-  mutable container_t m_sorted_values;
+  TPrevRange                  m_prev;
+  TKeySelector                m_key_selector;
+  sort_direction              m_sort_direction;
+  std::optional<executor_ref> m_executor;
+  mutable buffer_t            m_sorted_values;
+  mutable buffer_t            m_merge_buffer;
 };
 
 // ----------------------------------
@@ -1342,12 +4776,17 @@ class then_by_range
                 "A then_by operation can only be appended to another then_by or order_by operation.");
 
 public:
+  using allocator_type      = typename TPrevRange::allocator_type;
   using container_element_t = std::decay_t<typename TPrevRange::iterator::output_t>;
-  using container_t         = std::vector<container_element_t>;
+  using stored_t            = std::conditional_t<sorts_by_reference_v<TPrevRange>,
+                                                 const container_element_t*,
+                                                 container_element_t>;
+  using buffer_t            = scratch_buffer<stored_t, allocator_type>;
+  using container_t         = typename buffer_t::container_t;
   using container_iter_t    = typename container_t::const_iterator;
 
   struct iterator {
-    using output_t = typename container_iter_t::reference;
+    using output_t = const container_element_t&;
 
     explicit iterator(container_iter_t pos)
         : m_pos(pos) {
@@ -1367,34 +4806,66 @@ public:
     }
 
     output_t operator*() const {
-      return *m_pos;
+      return stored_value(*m_pos);
     }
 
     container_iter_t m_pos;
   };
 
+  static const container_element_t& stored_value(const stored_t& stored) {
+    if constexpr (sorts_by_reference_v<TPrevRange>) {
+      return *stored;
+    }
+    else {
+      return stored;
+    }
+  }
+
   then_by_range(const TPrevRange& prev, TKeySelector key_selector, sort_direction sort_dir)
       : m_prev(prev)
       , m_key_selector(std::move(key_selector))
-      , m_sort_direction(sort_dir) {
+      , m_sort_direction(sort_dir)
+      , m_sorted_values(prev.get_allocator())
+      , m_merge_buffer(prev.get_allocator()) {
   }
 
   iterator begin() const {
-    m_sorted_values.clear();
-    for (const auto& val : m_prev) {
-      m_sorted_values.emplace_back(val);
+    auto& sorted_values = m_sorted_values.values();
+    sorted_values.clear();
+
+    for (auto&& val : m_prev) {
+      if constexpr (sorts_by_reference_v<TPrevRange>) {
+        sorted_values.push_back(std::addressof(val));
+      }
+      else {
+        sorted_values.push_back(std::forward<decltype(val)>(val));
+      }
     }
 
-    std::stable_sort(
-        m_sorted_values.begin(),
-        m_sorted_values.end(),
-        [this](const container_element_t& a, const container_element_t& b) { return this->compare_keys(a, b); });
+    const auto compare = [this](const stored_t& a, const stored_t& b) {
+      return this->compare_keys(stored_value(a), stored_value(b));
+    };
+
+    if (const auto& executor = m_prev.executor()) {
+      parallel_stable_sort(*executor, sorted_values, m_merge_buffer.values(), compare);
+    }
+    else {
+      buffered_stable_sort(sorted_values, m_merge_buffer.values(), compare);
+    }
 
-    return iterator(m_sorted_values.begin());
+    return iterator(sorted_values.cbegin());
   }
 
   iterator end() const {
-    return iterator(m_sorted_values.end());
+    return iterator(m_sorted_values.values().cend());
+  }
+
+  static constexpr bool owns_elements  = !sorts_by_reference_v<TPrevRange>;
+  static constexpr bool holds_elements = owns_elements || TPrevRange::holds_elements;
+
+  container_t& owned_elements() {
+    (void)begin();
+    return m_sorted_values.values();
   }
 
   bool compare_keys(const container_element_t& a, const container_element_t& b) const {
@@ -1413,11 +4884,62 @@ public:
                                                          : /*descending:*/ b_value < a_value;
   }
 
+  const std::optional<executor_ref>& executor() const {
+    return m_prev.executor();
+  }
+
+  allocator_type get_allocator() const {
+    return m_sorted_values.get_allocator();
+  }
+
 private:
-  TPrevRange          m_prev;
-  TKeySelector        m_key_selector;
-  sort_direction      m_sort_direction;
-  mutable container_t m_sorted_values;
+  TPrevRange       m_prev;
+  TKeySelector     m_key_selector;
+  sort_direction   m_sort_direction;
+  mutable buffer_t m_sorted_values;
+  mutable buffer_t m_merge_buffer;
+};
+
+// ----------------------------------
+// Key range bounds
+// ----------------------------------
+
+// The bounds of key ranges. Each one finds its position in an ordered associative container.
+
+struct key_begin_bound {
+  template <typename TContainer>
+  auto find(const TContainer& container) const {
+    return container.cbegin();
+  }
+};
+
+struct key_end_bound {
+  template <typename TContainer>
+  auto find(const TContainer& container) const {
+    return container.cend();
+  }
+};
+
+// The first element whose key is not less than key.
+template <typename TKey>
+struct key_lower_bound {
+  template <typename TContainer>
+  auto find(const TContainer& container) const {
+    return container.lower_bound(key);
+  }
+
+  TKey key;
+};
+
+// The first element whose key is greater than key.
+template <typename TKey>
+struct key_upper_bound {
+  template <typename TContainer>
+  auto find(const TContainer& container) const {
+    return container.upper_bound(key);
+  }
+
+  TKey key;
 };
 
 // ----------------------------------
@@ -1450,45 +4972,351 @@ public:
       return *this;
     }
 
-    output_t operator*() const {
+    output_t operator*() const {
+      return *m_pos;
+    }
+
+    container_iter_t m_pos{};
+  };
+
+  container_range() = default;
+
+  explicit container_range(const TContainer* container)
+      : m_container(container) {
+    assert(container != nullptr && "null container given to range");
+  }
+
+  iterator begin() const {
+    return iterator(m_container->cbegin());
+  }
+
+  iterator end() const {
+    return iterator(m_container->cend());
+  }
+
+  static constexpr bool is_sliceable   = is_random_access_iterator_v<typename TContainer::const_iterator>;
+  static constexpr bool is_contiguous  = is_contiguous_container_v<TContainer>;
+  static constexpr bool is_indexed     = is_sliceable;
+  static constexpr bool is_associative = is_associative_container_v<TContainer>;
+
+  const TContainer& container() const {
+    return *m_container;
+  }
+
+  size_t slice_count() const {
+    return static_cast<size_t>(m_container->cend() - m_container->cbegin());
+  }
+
+  auto data() const {
+    return m_container->data();
+  }
+
+  typename TContainer::const_reference at(size_t index) const {
+    return m_container->cbegin()[static_cast<std::ptrdiff_t>(index)];
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto begin = m_container->cbegin();
+    return {iterator(begin + static_cast<std::ptrdiff_t>(first)), iterator(begin + static_cast<std::ptrdiff_t>(last))};
+  }
+
+  // Key ranges
+  //
+  // Ordered associative containers (std::map, std::set, ...) can be restricted to the elements
+  // of a key range. The bounds are found using lower_bound/upper_bound when the range is iterated,
+  // so only the elements in the range are visited, which is O(log n + k) instead of the full scan
+  // that where() does.
+
+  // Elements whose key is in [low, high).
+  template <typename TLow, typename THigh>
+  [[nodiscard]] auto where_key_between(const TLow& low, const THigh& high) const {
+    using first_t = key_lower_bound<std::decay_t<TLow>>;
+    using last_t  = key_lower_bound<std::decay_t<THigh>>;
+
+    return key_range<TContainer, first_t, last_t>{m_container, {low}, {high}, m_container->key_comp()(high, low)};
+  }
+
+  // Elements whose key is >= key.
+  template <typename TKey>
+  [[nodiscard]] auto where_key_at_least(const TKey& key) const {
+    using first_t = key_lower_bound<std::decay_t<TKey>>;
+    return key_range<TContainer, first_t, key_end_bound>{m_container, {key}, {}};
+  }
+
+  // Elements whose key is > key.
+  template <typename TKey>
+  [[nodiscard]] auto where_key_greater_than(const TKey& key) const {
+    using first_t = key_upper_bound<std::decay_t<TKey>>;
+    return key_range<TContainer, first_t, key_end_bound>{m_container, {key}, {}};
+  }
+
+  // Elements whose key is < key.
+  template <typename TKey>
+  [[nodiscard]] auto where_key_less_than(const TKey& key) const {
+    using last_t = key_lower_bound<std::decay_t<TKey>>;
+    return key_range<TContainer, key_begin_bound, last_t>{m_container, {}, {key}};
+  }
+
+  // Elements whose key is <= key.
+  template <typename TKey>
+  [[nodiscard]] auto where_key_at_most(const TKey& key) const {
+    using last_t = key_upper_bound<std::decay_t<TKey>>;
+    return key_range<TContainer, key_begin_bound, last_t>{m_container, {}, {key}};
+  }
+
+private:
+  const TContainer* m_container{};
+};
+
+// ----------------------------------
+// key_range
+// ----------------------------------
+
+// Ranges over the elements of an ordered associative container between two bounds, see
+// container_range::where_key_between. The bounds are looked up whenever the range is iterated,
+// so the range reflects changes to the container like every other source.
+template <typename TContainer, typename TFirstBound, typename TLastBound>
+class key_range
+    : public base_range<key_range<TContainer, TFirstBound, TLastBound>, typename TContainer::value_type> {
+public:
+  using iterator = typename container_range<TContainer>::iterator;
+
+  key_range() = default;
+
+  key_range(const TContainer* container, TFirstBound first, TLastBound last, bool is_empty = false)
+      : m_container(container)
+      , m_first(std::move(first))
+      , m_last(std::move(last))
+      , m_is_empty(is_empty) {
+  }
+
+  iterator begin() const {
+    return iterator(m_first.find(*m_container));
+  }
+
+  iterator end() const {
+    // An empty interval ends where it begins, even if its last bound precedes its first.
+    return m_is_empty ? begin() : iterator(m_last.find(*m_container));
+  }
+
+private:
+  const TContainer* m_container{};
+  TFirstBound       m_first{};
+  TLastBound        m_last{};
+  bool              m_is_empty{};
+};
+
+// ----------------------------------
+// bucket_container_range
+// ----------------------------------
+
+// Ranges over a hash container such as std::unordered_map or std::unordered_set.
+// Sequential iteration walks the container as usual. Slices are ranges of buckets instead,
+// which lets parallel operators split the container across tasks without walking it first.
+template <typename TContainer>
+class bucket_container_range
+    : public base_range<bucket_container_range<TContainer>, typename TContainer::value_type> {
+public:
+  struct iterator {
+    using container_iter_t = typename TContainer::const_iterator;
+    using local_iter_t     = typename TContainer::const_local_iterator;
+    using output_t         = typename TContainer::const_reference;
+
+    iterator() = default;
+
+    explicit iterator(container_iter_t pos)
+        : m_pos(pos) {
+    }
+
+    // Iterates the elements of the buckets [bucket, last_bucket), where last_bucket > 0.
+    iterator(const TContainer* container, size_t bucket, size_t last_bucket)
+        : m_container(container)
+        , m_bucket(bucket)
+        , m_last_bucket(last_bucket)
+        , m_local(container->cend(last_bucket - 1)) {
+      if (m_bucket != m_last_bucket) {
+        m_local = m_container->cbegin(m_bucket);
+        seek_element();
+      }
+    }
+
+    bool operator==(const iterator& o) const {
+      if (m_container == nullptr) {
+        return m_pos == o.m_pos;
+      }
+
+      return m_bucket == o.m_bucket && (m_bucket == m_last_bucket || m_local == o.m_local);
+    }
+
+    bool operator!=(const iterator& o) const {
+      return !(*this == o);
+    }
+
+    iterator& operator++() {
+      if (m_container == nullptr) {
+        ++m_pos;
+      }
+      else {
+        ++m_local;
+        seek_element();
+      }
+
+      return *this;
+    }
+
+    output_t operator*() const {
+      return m_container == nullptr ? *m_pos : *m_local;
+    }
+
+    // Skips empty buckets until m_local points to an element or all buckets are consumed.
+    void seek_element() {
+      while (m_local == m_container->cend(m_bucket)) {
+        if (++m_bucket == m_last_bucket) {
+          break;
+        }
+
+        m_local = m_container->cbegin(m_bucket);
+      }
+    }
+
+    container_iter_t  m_pos{};
+    const TContainer* m_container{};
+    size_t            m_bucket{};
+    size_t            m_last_bucket{};
+    local_iter_t      m_local{};
+  };
+
+  bucket_container_range() = default;
+
+  explicit bucket_container_range(const TContainer* container)
+      : m_container(container) {
+    assert(container != nullptr && "null container given to range");
+  }
+
+  iterator begin() const {
+    return iterator(m_container->cbegin());
+  }
+
+  iterator end() const {
+    return iterator(m_container->cend());
+  }
+
+  static constexpr bool is_sliceable   = true;
+  static constexpr bool is_associative = true;
+
+  const TContainer& container() const {
+    return *m_container;
+  }
+
+  size_t slice_count() const {
+    return m_container->bucket_count();
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator(m_container, first, last), iterator(m_container, last, last)};
+  }
+
+private:
+  const TContainer* m_container{};
+};
+
+// The range type that from() creates for a container.
+template <typename TContainer>
+using container_range_t = std::conditional_t<is_bucketed_container_v<TContainer>,
+                                             bucket_container_range<TContainer>,
+                                             container_range<TContainer>>;
+
+// ----------------------------------
+// mutable_container_range
+// ----------------------------------
+
+template <typename TContainer>
+class mutable_container_range
+    : public base_range<mutable_container_range<TContainer>, typename TContainer::value_type> {
+public:
+  struct iterator {
+    using container_iter_t = typename TContainer::iterator;
+    using output_t         = typename TContainer::reference;
+
+    explicit iterator(container_iter_t pos)
+        : m_pos(pos) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_pos == o.m_pos;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_pos != o.m_pos;
+    }
+
+    iterator& operator++() {
+      ++m_pos;
+      return *this;
+    }
+
+    output_t& operator*() const {
       return *m_pos;
     }
 
-    container_iter_t m_pos{};
+    container_iter_t m_pos;
   };
 
-  container_range() = default;
-
-  explicit container_range(const TContainer* container)
+  explicit mutable_container_range(TContainer* container)
       : m_container(container) {
     assert(container != nullptr && "null container given to range");
   }
 
   iterator begin() const {
-    return iterator(m_container->cbegin());
+    return iterator(m_container->begin());
   }
 
   iterator end() const {
-    return iterator(m_container->cend());
+    return iterator(m_container->end());
+  }
+
+  static constexpr bool is_sliceable   = is_random_access_iterator_v<typename TContainer::iterator>;
+  static constexpr bool is_contiguous  = is_contiguous_container_v<TContainer>;
+  static constexpr bool is_indexed     = is_sliceable;
+  static constexpr bool is_associative = is_associative_container_v<TContainer>;
+
+  const TContainer& container() const {
+    return *m_container;
+  }
+
+  size_t slice_count() const {
+    return static_cast<size_t>(m_container->end() - m_container->begin());
+  }
+
+  auto data() const {
+    return std::as_const(*m_container).data();
+  }
+
+  typename TContainer::reference at(size_t index) const {
+    return m_container->begin()[static_cast<std::ptrdiff_t>(index)];
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    const auto begin = m_container->begin();
+    return {iterator(begin + static_cast<std::ptrdiff_t>(first)), iterator(begin + static_cast<std::ptrdiff_t>(last))};
   }
 
 private:
-  const TContainer* m_container{};
+  TContainer* m_container{};
 };
 
 // ----------------------------------
-// mutable_container_range
+// pointer_range
 // ----------------------------------
 
-template <typename TContainer>
-class mutable_container_range
-    : public base_range<mutable_container_range<TContainer>, typename TContainer::value_type> {
+// Ranges over count elements starting at data, such as C arrays and spans.
+template <typename T>
+class pointer_range : public base_range<pointer_range<T>, std::remove_const_t<T>> {
 public:
   struct iterator {
-    using container_iter_t = typename TContainer::iterator;
-    using output_t         = typename TContainer::reference;
+    using output_t = T&;
 
-    explicit iterator(container_iter_t pos)
+    explicit iterator(T* pos)
         : m_pos(pos) {
     }
 
@@ -1505,28 +5333,50 @@ public:
       return *this;
     }
 
-    output_t& operator*() const {
+    T& operator*() const {
       return *m_pos;
     }
 
-    container_iter_t m_pos;
+    T* m_pos;
   };
 
-  explicit mutable_container_range(TContainer* container)
-      : m_container(container) {
-    assert(container != nullptr && "null container given to range");
+  pointer_range(T* data, size_t count)
+      : m_data(data)
+      , m_count(count) {
+    assert((data != nullptr || count == 0) && "null pointer given to range");
   }
 
   iterator begin() const {
-    return iterator(m_container->begin());
+    return iterator(m_data);
   }
 
   iterator end() const {
-    return iterator(m_container->end());
+    return iterator(m_data + m_count);
+  }
+
+  static constexpr bool is_sliceable  = true;
+  static constexpr bool is_contiguous = true;
+  static constexpr bool is_indexed    = true;
+
+  size_t slice_count() const {
+    return m_count;
+  }
+
+  const T* data() const {
+    return m_data;
+  }
+
+  T& at(size_t index) const {
+    return m_data[index];
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator(m_data + first), iterator(m_data + last)};
   }
 
 private:
-  TContainer* m_container{};
+  T*     m_data{};
+  size_t m_count{};
 };
 
 // ----------------------------------
@@ -1537,8 +5387,8 @@ template <typename TContainer>
 class container_copy_range : public base_range<container_copy_range<TContainer>, typename TContainer::value_type> {
 public:
   struct iterator {
-    using container_iter_t = typename TContainer::iterator;
-    using output_t         = typename TContainer::reference;
+    using container_iter_t = typename TContainer::const_iterator;
+    using output_t         = typename TContainer::const_reference;
 
     explicit iterator(container_iter_t pos)
         : m_pos(pos) {
@@ -1557,15 +5407,15 @@ public:
       return *this;
     }
 
-    output_t& operator*() const {
+    output_t operator*() const {
       return *m_pos;
     }
 
     container_iter_t m_pos;
   };
 
-  explicit container_copy_range(const TContainer& container)
-      : m_container(container) {
+  explicit container_copy_range(TContainer container)
+      : m_container(std::move(container)) {
   }
 
   iterator begin() const {
@@ -1576,6 +5426,18 @@ public:
     return iterator{m_container.end()};
   }
 
+  static constexpr bool owns_elements  = true;
+  static constexpr bool holds_elements = true;
+  static constexpr bool is_associative = is_associative_container_v<TContainer>;
+
+  TContainer& owned_elements() {
+    return m_container;
+  }
+
+  const TContainer& container() const {
+    return m_container;
+  }
+
 private:
   TContainer m_container{};
 };
@@ -1584,14 +5446,18 @@ private:
 // from_initializer_list
 // ----------------------------------
 
-template <typename T, typename TContainer = std::vector<T>>
-class initializer_list_range : public base_range<initializer_list_range<T>, typename TContainer::const_iterator> {
+// Small lists are stored inline, larger ones are copied to the heap. This keeps
+// ranges such as linq::from({a, b, c}) inside a select_many free of allocations.
+template <typename T, typename TAllocator = std::allocator<T>>
+class initializer_list_range : public base_range<initializer_list_range<T, TAllocator>, T> {
 public:
+  // The number of elements that fit into the inline storage.
+  static constexpr size_t inline_capacity = std::max(size_t{64} / sizeof(T), size_t{1});
+
   struct iterator {
-    using container_iter_t = typename TContainer::const_iterator;
-    using output_t         = typename TContainer::const_reference;
+    using output_t = const T&;
 
-    explicit iterator(container_iter_t pos)
+    explicit iterator(const T* pos)
         : m_pos(pos) {
     }
 
@@ -1608,46 +5474,181 @@ public:
       return *this;
     }
 
-    const output_t& operator*() const {
+    const T& operator*() const {
       return *m_pos;
     }
 
-    container_iter_t m_pos;
+    const T* m_pos;
   };
 
-  explicit initializer_list_range(std::initializer_list<T> list)
-      : m_list(list.begin(), list.end()) {
+  initializer_list_range() = default;
+
+  explicit initializer_list_range(std::initializer_list<T> list, const TAllocator& allocator = TAllocator())
+      : m_heap(allocator) {
+    assign(list.begin(), list.size());
+  }
+
+  // Copies keep the allocator of the original.
+  initializer_list_range(const initializer_list_range& copy_from)
+      : m_heap(copy_from.m_heap.get_allocator()) {
+    assign(copy_from.data(), copy_from.m_size);
+  }
+
+  initializer_list_range(initializer_list_range&& move_from) noexcept(std::is_nothrow_move_constructible_v<T>)
+      : m_heap(std::move(move_from.m_heap)) {
+    if (move_from.is_inline()) {
+      std::uninitialized_move_n(move_from.inline_data(), move_from.m_size, inline_data());
+    }
+
+    m_size = move_from.m_size;
+    move_from.destroy_inline();
+  }
+
+  ~initializer_list_range() {
+    destroy_inline();
+  }
+
+  initializer_list_range& operator=(const initializer_list_range& copy_from) {
+    if (this != &copy_from) {
+      destroy_inline();
+      assign(copy_from.data(), copy_from.m_size);
+    }
+
+    return *this;
+  }
+
+  initializer_list_range& operator=(initializer_list_range&& move_from) noexcept(
+      std::is_nothrow_move_constructible_v<T>) {
+    if (this != &move_from) {
+      destroy_inline();
+
+      if (move_from.is_inline()) {
+        m_heap.clear();
+        std::uninitialized_move_n(move_from.inline_data(), move_from.m_size, inline_data());
+      }
+      else {
+        m_heap = std::move(move_from.m_heap);
+      }
+
+      m_size = move_from.m_size;
+      move_from.destroy_inline();
+    }
+
+    return *this;
   }
 
   iterator begin() const {
-    return iterator(m_list.begin());
+    return iterator(data());
   }
 
   iterator end() const {
-    return iterator(m_list.end());
+    return iterator(data() + m_size);
+  }
+
+  static constexpr bool is_sliceable   = true;
+  static constexpr bool is_contiguous  = true;
+  static constexpr bool is_indexed     = true;
+  static constexpr bool holds_elements = true;
+
+  size_t slice_count() const {
+    return m_size;
+  }
+
+  const T* data() const {
+    return is_inline() ? inline_data() : m_heap.data();
+  }
+
+  const T& at(size_t index) const {
+    return data()[index];
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator(data() + first), iterator(data() + last)};
   }
 
 private:
-  std::vector<T> m_list{};
+  bool is_inline() const {
+    return m_size <= inline_capacity;
+  }
+
+  T* inline_data() {
+    return reinterpret_cast<T*>(m_inline);
+  }
+
+  const T* inline_data() const {
+    return reinterpret_cast<const T*>(m_inline);
+  }
+
+  // Expects the inline storage to be empty.
+  void assign(const T* values, size_t count) {
+    m_size = 0;
+
+    if (count <= inline_capacity) {
+      m_heap.clear();
+      std::uninitialized_copy_n(values, count, inline_data());
+    }
+    else {
+      m_heap.assign(values, values + count);
+    }
+
+    m_size = count;
+  }
+
+  void destroy_inline() {
+    if (is_inline()) {
+      std::destroy_n(inline_data(), m_size);
+    }
+
+    m_size = 0;
+  }
+
+  std::vector<T, TAllocator> m_heap;
+  size_t                     m_size{};
+  alignas(T) std::byte m_inline[inline_capacity * sizeof(T)];
 };
 
 // ----------------------------------
 // from_to_range
 // ----------------------------------
 
+// The unsigned type in which the arithmetic of integer sequences is done. Unsigned arithmetic wraps
+// instead of overflowing, and the results are exact whenever they fit into T.
+template <typename T, bool = std::is_integral_v<T> && !std::is_same_v<T, bool>>
+struct wrapping_type {
+  using type = void;
+};
+
+template <typename T>
+struct wrapping_type<T, true> {
+  using type = std::common_type_t<std::make_unsigned_t<T>, unsigned>;
+};
+
 template <typename T>
 class from_to_range : public base_range<from_to_range<T>, T> {
+  using wrapping_t = typename wrapping_type<T>::type;
+
 public:
+  // Integer sequences have a closed form, i.e. every element can be computed from its index.
+  static constexpr bool is_sliceable           = !std::is_void_v<wrapping_t>;
+  static constexpr bool is_indexed             = is_sliceable;
+  static constexpr bool is_arithmetic_sequence = is_sliceable;
+
   struct iterator {
     using output_t = T;
 
-    iterator(output_t value, const output_t* step)
+    iterator(output_t value, size_t index, const output_t* step)
         : m_value(std::move(value))
+        , m_index(index)
         , m_step(step) {
     }
 
     bool operator==(const iterator& o) const {
-      return o.m_value < m_value;
+      if constexpr (is_indexed) {
+        return m_index == o.m_index;
+      }
+      else {
+        return o.m_value < m_value;
+      }
     }
 
     bool operator!=(const iterator& o) const {
@@ -1655,7 +5656,15 @@ public:
     }
 
     iterator& operator++() {
-      m_value += *m_step;
+      if constexpr (is_indexed) {
+        // Stepping past the last element wraps, e.g. in from_to(0, INT_MAX).
+        m_value = static_cast<T>(static_cast<wrapping_t>(m_value) + static_cast<wrapping_t>(*m_step));
+        ++m_index;
+      }
+      else {
+        m_value += *m_step;
+      }
+
       return *this;
     }
 
@@ -1664,6 +5673,7 @@ public:
     }
 
     output_t        m_value;
+    size_t          m_index;
     const output_t* m_step;
   };
 
@@ -1672,20 +5682,63 @@ public:
       , m_end(std::move(end))
       , m_step(std::move(step)) {
     assert(m_start < m_end);
+
+    if (!(T{0} < m_step)) {
+      throw std::invalid_argument("from_to requires a positive step");
+    }
+
+    if constexpr (is_indexed) {
+      const wrapping_t distance   = static_cast<wrapping_t>(m_end) - static_cast<wrapping_t>(m_start);
+      const wrapping_t last_index = distance / static_cast<wrapping_t>(m_step);
+
+      // The full width of a 64-bit type, e.g. from_to<uint64_t>(0, UINT64_MAX), has one element more
+      // than size_t can count.
+      if (last_index >= static_cast<wrapping_t>(std::numeric_limits<size_t>::max())) {
+        throw std::length_error("from_to range has too many elements to count");
+      }
+
+      m_count = static_cast<size_t>(last_index) + 1;
+    }
   }
 
   iterator begin() const {
-    return iterator{m_start, std::addressof(m_step)};
+    return iterator{m_start, 0, std::addressof(m_step)};
   }
 
   iterator end() const {
-    return iterator{m_end, std::addressof(m_step)};
+    return iterator{m_end, m_count, std::addressof(m_step)};
+  }
+
+  size_t slice_count() const {
+    return m_count;
+  }
+
+  T at(size_t index) const {
+    return static_cast<T>(static_cast<wrapping_t>(m_start) +
+                          static_cast<wrapping_t>(index) * static_cast<wrapping_t>(m_step));
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator{at(first), first, std::addressof(m_step)}, iterator{m_end, last, std::addressof(m_step)}};
+  }
+
+  // The closed form of sum(): count * start + step * count * (count - 1) / 2.
+  T sequence_sum() const {
+    const size_t n = m_count;
+
+    // Halve the even factor of count * (count - 1) before the product can wrap.
+    const wrapping_t triangle = n % 2 == 0 ? static_cast<wrapping_t>(n / 2) * static_cast<wrapping_t>(n - 1)
+                                           : static_cast<wrapping_t>(n) * static_cast<wrapping_t>((n - 1) / 2);
+
+    return static_cast<T>(static_cast<wrapping_t>(n) * static_cast<wrapping_t>(m_start) +
+                          triangle * static_cast<wrapping_t>(m_step));
   }
 
 private:
-  T m_start;
-  T m_end;
-  T m_step;
+  T      m_start;
+  T      m_end;
+  T      m_step;
+  size_t m_count{};
 };
 
 // ----------------------------------
@@ -1719,78 +5772,215 @@ struct generator_return_value : generator_return_value_ident {
     return m_is_empty != o.m_is_empty;
   }
 
-  T    m_value{};
-  bool m_is_empty{true};
+  T    m_value{};
+  bool m_is_empty{true};
+};
+
+template <typename TGenerator>
+struct generate_range_traits {
+  using generator_return_type = std::invoke_result_t<TGenerator, size_t>;
+
+  // Ensure that whatever the generator returned is indeed of type generator_return_type.
+  static_assert(std::is_base_of_v<generator_return_value_ident, generator_return_type>,
+                "The generator function is expected to return a result of linq::generate_return() or "
+                "linq::generate_finish().");
+
+  // The type that is wrapped by the returned generator_return_type.
+  using value_type = typename generator_return_type::value_type;
+};
+
+template <typename TGenerator>
+class generator_range
+    : public base_range<generator_range<TGenerator>, typename generate_range_traits<TGenerator>::value_type> {
+public:
+  struct iterator {
+    using generator_return_type = typename generate_range_traits<TGenerator>::generator_return_type;
+    using output_t              = typename generate_range_traits<TGenerator>::value_type;
+
+    iterator(const generator_range* parent, bool is_end)
+        : m_parent(parent) {
+      if (is_end) {
+        m_last_result = generator_return_type();
+      }
+      else {
+        // First iteration
+        m_last_result = m_parent->m_generator(m_iteration);
+      }
+    }
+
+    bool operator==(const iterator& o) const {
+      return m_last_result == o.m_last_result;
+    }
+
+    bool operator!=(const iterator& o) const {
+      return m_last_result != o.m_last_result;
+    }
+
+    iterator& operator++() {
+      ++m_iteration;
+      m_last_result = m_parent->m_generator(m_iteration);
+      return *this;
+    }
+
+    const output_t& operator*() const {
+      return m_last_result.m_value;
+    }
+
+    const generator_range* m_parent;
+    size_t                 m_iteration{};
+    generator_return_type  m_last_result;
+  };
+
+  explicit generator_range(TGenerator generator)
+      : m_generator(std::move(generator)) {
+  }
+
+  iterator begin() const {
+    return iterator(this, false);
+  }
+
+  iterator end() const {
+    return iterator(this, true);
+  }
+
+private:
+  TGenerator m_generator;
+};
+
+#ifdef __cpp_lib_coroutine
+// ----------------------------------
+// coroutine_range
+// ----------------------------------
+
+// Ranges over the elements that a generator coroutine yields. Like the coroutine itself, the range is
+// single-pass: copies of it share the coroutine, and iterating it again continues where the last
+// iteration stopped.
+template <typename T>
+class coroutine_range : public base_range<coroutine_range<T>, T> {
+public:
+  struct iterator {
+    // Like in generator_range, the element is a value: the reference is only valid until the
+    // coroutine is resumed, so operators must not keep pointers to elements (e.g. to sort them).
+    using output_t = T;
+
+    explicit iterator(generator<T>* coroutine)
+        : m_generator(coroutine) {
+    }
+
+    bool operator==(const iterator& o) const {
+      return done() == o.done();
+    }
+
+    bool operator!=(const iterator& o) const {
+      return done() != o.done();
+    }
+
+    iterator& operator++() {
+      m_generator->resume();
+      return *this;
+    }
+
+    const T& operator*() const {
+      return m_generator->value();
+    }
+
+    bool done() const {
+      return m_generator == nullptr || m_generator->done();
+    }
+
+    generator<T>* m_generator;
+  };
+
+  explicit coroutine_range(generator<T> coroutine)
+      : m_generator(std::make_shared<generator<T>>(std::move(coroutine))) {
+  }
+
+  iterator begin() const {
+    m_generator->start();
+    return iterator(m_generator.get());
+  }
+
+  iterator end() const {
+    return iterator(nullptr);
+  }
+
+private:
+  std::shared_ptr<generator<T>> m_generator;
 };
+#endif
 
-template <typename TGenerator>
-struct generate_range_traits {
-  using generator_return_type = std::invoke_result_t<TGenerator, size_t>;
-
-  // Ensure that whatever the generator returned is indeed of type generator_return_type.
-  static_assert(std::is_base_of_v<generator_return_value_ident, generator_return_type>,
-                "The generator function is expected to return a result of linq::generate_return() or "
-                "linq::generate_finish().");
+// ----------------------------------
+// indexed_generator_range
+// ----------------------------------
 
-  // The type that is wrapped by the returned generator_return_type.
-  using value_type = typename generator_return_type::value_type;
-};
+template <typename TGenerator>
+using indexed_generator_output_t = std::decay_t<std::invoke_result_t<const TGenerator&, size_t>>;
 
+// Ranges over generator(0), ..., generator(count - 1). Because every element only depends on its
+// index, the range is indexed: it can be sliced by parallel operators and skipped in constant time.
 template <typename TGenerator>
-class generator_range
-    : public base_range<generator_range<TGenerator>, typename generate_range_traits<TGenerator>::value_type> {
+class indexed_generator_range
+    : public base_range<indexed_generator_range<TGenerator>, indexed_generator_output_t<TGenerator>> {
 public:
   struct iterator {
-    using generator_return_type = typename generate_range_traits<TGenerator>::generator_return_type;
-    using output_t              = typename generate_range_traits<TGenerator>::value_type;
+    using output_t = indexed_generator_output_t<TGenerator>;
 
-    iterator(const generator_range* parent, bool is_end)
-        : m_parent(parent) {
-      if (is_end) {
-        m_last_result = generator_return_type();
-      }
-      else {
-        // First iteration
-        m_last_result = m_parent->m_generator(m_iteration);
-      }
+    iterator(const indexed_generator_range* parent, size_t index)
+        : m_parent(parent)
+        , m_index(index) {
     }
 
     bool operator==(const iterator& o) const {
-      return m_last_result == o.m_last_result;
+      return m_index == o.m_index;
     }
 
     bool operator!=(const iterator& o) const {
-      return m_last_result != o.m_last_result;
+      return m_index != o.m_index;
     }
 
     iterator& operator++() {
-      ++m_iteration;
-      m_last_result = m_parent->m_generator(m_iteration);
+      ++m_index;
       return *this;
     }
 
-    const output_t& operator*() const {
-      return m_last_result.m_value;
+    output_t operator*() const {
+      return m_parent->m_generator(m_index);
     }
 
-    const generator_range* m_parent;
-    size_t                 m_iteration{};
-    generator_return_type  m_last_result;
+    const indexed_generator_range* m_parent;
+    size_t                         m_index;
   };
 
-  explicit generator_range(TGenerator generator)
-      : m_generator(std::move(generator)) {
+  indexed_generator_range(size_t count, TGenerator generator)
+      : m_count(count)
+      , m_generator(std::move(generator)) {
   }
 
   iterator begin() const {
-    return iterator(this, false);
+    return iterator(this, 0);
   }
 
   iterator end() const {
-    return iterator(this, true);
+    return iterator(this, m_count);
+  }
+
+  static constexpr bool is_sliceable = true;
+  static constexpr bool is_indexed   = true;
+
+  size_t slice_count() const {
+    return m_count;
+  }
+
+  indexed_generator_output_t<TGenerator> at(size_t index) const {
+    return m_generator(index);
+  }
+
+  std::pair<iterator, iterator> slice(size_t first, size_t last) const {
+    return {iterator(this, first), iterator(this, last)};
   }
 
 private:
+  size_t     m_count{};
   TGenerator m_generator;
 };
 
@@ -1809,17 +5999,55 @@ auto base_range<TMy, TOutput>::distinct() const {
   return distinct_range<TMy>(static_cast<const TMy&>(*this));
 }
 
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::distinct(const TAllocator& allocator) const {
+  return distinct_range<TMy, TAllocator>(static_cast<const TMy&>(*this), allocator);
+}
+
 template <typename TMy, typename TOutput>
 template <typename TTransform>
 auto base_range<TMy, TOutput>::select(TTransform&& transform) const {
   return select_range<TMy, TTransform>(static_cast<const TMy&>(*this), std::forward<TTransform>(transform));
 }
 
+template <typename TMy, typename TOutput>
+template <typename TTransform>
+auto base_range<TMy, TOutput>::select_ref(TTransform&& transform) const {
+  using iter_output_t = typename TMy::iterator::output_t;
+
+  static_assert(std::is_lvalue_reference_v<iter_output_t>,
+                "select_ref requires a range whose elements are references; use select instead.");
+
+  static_assert(std::is_lvalue_reference_v<select_output_t<TMy, TTransform>>,
+                "The transform of select_ref must return an lvalue reference.");
+
+  return select(std::forward<TTransform>(transform));
+}
+
+template <typename TMy, typename TOutput>
+template <typename TClass, typename TMember>
+auto base_range<TMy, TOutput>::select_member(TMember TClass::*member) const {
+  return select_ref(member_selector<TClass, TMember>{member});
+}
+
 template <typename TMy, typename TOutput>
 [[nodiscard]] auto base_range<TMy, TOutput>::select_to_string() const {
   return select_to_string_range<TMy>(static_cast<const TMy&>(*this));
 }
 
+template <typename TMy, typename TOutput>
+[[nodiscard]] auto base_range<TMy, TOutput>::select_to_string_view(float_format format) const {
+  return select_to_string_view_range<TMy>(static_cast<const TMy&>(*this), format);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+[[nodiscard]] auto base_range<TMy, TOutput>::select_to_string_view(float_format      format,
+                                                                  const TAllocator& allocator) const {
+  return select_to_string_view_range<TMy, TAllocator>(static_cast<const TMy&>(*this), format, allocator);
+}
+
 template <typename TMy, typename TOutput>
 template <typename TTransform>
 auto base_range<TMy, TOutput>::select_many(TTransform&& transform) const {
@@ -1831,6 +6059,12 @@ auto base_range<TMy, TOutput>::reverse() const {
   return reverse_range<TMy>(static_cast<const TMy&>(*this));
 }
 
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::reverse(const TAllocator& allocator) const {
+  return reverse_range<TMy, TAllocator>(static_cast<const TMy&>(*this), allocator);
+}
+
 template <typename TMy, typename TOutput>
 auto base_range<TMy, TOutput>::take(size_t count) const {
   return take_range<TMy>(static_cast<const TMy&>(*this), count);
@@ -1864,6 +6098,100 @@ auto base_range<TMy, TOutput>::repeat(size_t count) const {
   return repeat_range<TMy>(static_cast<const TMy&>(*this), count);
 }
 
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::chunk(size_t size) const {
+  return chunk_range<TMy>(static_cast<const TMy&>(*this), size);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::chunk(size_t size, const TAllocator& allocator) const {
+  return chunk_range<TMy, TAllocator>(static_cast<const TMy&>(*this), size, allocator);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TOperation>
+auto base_range<TMy, TOutput>::scan(TOperation&& operation) const {
+  return scan_range<TMy, TOperation, output_t, true>(static_cast<const TMy&>(*this),
+                                                     std::forward<TOperation>(operation));
+}
+
+template <typename TMy, typename TOutput>
+template <typename TInit, typename TOperation>
+auto base_range<TMy, TOutput>::exclusive_scan(TInit init, TOperation&& operation) const {
+  return scan_range<TMy, TOperation, TInit, false>(static_cast<const TMy&>(*this),
+                                                   std::forward<TOperation>(operation),
+                                                   std::move(init));
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::window(size_t size) const {
+  return window_range<TMy>(static_cast<const TMy&>(*this), size);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::window(size_t size, const TAllocator& allocator) const {
+  return window_range<TMy, TAllocator>(static_cast<const TMy&>(*this), size, allocator);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAggregation, typename TAllocator>
+auto base_range<TMy, TOutput>::window_aggregate(size_t            size,
+                                                TAggregation      aggregation,
+                                                const TAllocator& allocator) const {
+  using aggregator_t = typename window_aggregator<TAggregation, output_t, TAllocator>::type;
+  using range_t      = window_aggregate_range<TMy, aggregator_t, TAllocator>;
+
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (std::is_same_v<aggregator_t, TAggregation>) {
+    return range_t(self, size, std::move(aggregation), allocator);
+  }
+  else if constexpr (std::is_constructible_v<aggregator_t, const TAllocator&>) {
+    return range_t(self, size, aggregator_t(allocator), allocator);
+  }
+  else {
+    return range_t(self, size, aggregator_t{}, allocator);
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <size_t Count>
+auto base_range<TMy, TOutput>::tee() const {
+  return tee<Count>(std::allocator<std::byte>());
+}
+
+template <typename TMy, typename TOutput>
+template <size_t Count, typename TAllocator>
+auto base_range<TMy, TOutput>::tee(const TAllocator& allocator) const {
+  static_assert(Count > 0, "tee() needs at least one consumer");
+
+  using state_t = tee_state<TMy, TAllocator>;
+
+  return make_tee_ranges(std::allocate_shared<state_t>(rebind_alloc_t<TAllocator, state_t>(allocator),
+                                                       static_cast<const TMy&>(*this),
+                                                       Count,
+                                                       allocator),
+                         std::make_index_sequence<Count>{});
+}
+
+template <typename TMy, typename TOutput>
+template <typename... TOtherRanges>
+auto base_range<TMy, TOutput>::zip(const TOtherRanges&... other_ranges) const {
+  using transform_t = zip_tuple_transform<(TMy::holds_elements || ... || TOtherRanges::holds_elements)>;
+
+  return zip_range<transform_t, TMy, TOtherRanges...>(transform_t{}, static_cast<const TMy&>(*this), other_ranges...);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TOtherRange, typename TTransform>
+auto base_range<TMy, TOutput>::zip_with(const TOtherRange& other_range, TTransform&& transform) const {
+  return zip_range<TTransform, TMy, TOtherRange>(std::forward<TTransform>(transform),
+                                                 static_cast<const TMy&>(*this),
+                                                 other_range);
+}
+
 template <typename TMy, typename TOutput>
 template <typename TOtherRange, typename TKeySelectorA, typename TKeySelectorB, typename TTransform>
 auto base_range<TMy, TOutput>::join(const TOtherRange& other_range,
@@ -1885,6 +6213,42 @@ auto base_range<TMy, TOutput>::order_by(TKeySelector&& key_selector, sort_direct
                                            sort_dir);
 }
 
+template <typename TMy, typename TOutput>
+template <typename TKeySelector, typename TAllocator>
+auto base_range<TMy, TOutput>::order_by(TKeySelector&&    key_selector,
+                                        sort_direction    sort_dir,
+                                        const TAllocator& allocator) const {
+  return order_by_range<TMy, TKeySelector, TAllocator>(static_cast<const TMy&>(*this),
+                                                       std::forward<TKeySelector>(key_selector),
+                                                       sort_dir,
+                                                       std::nullopt,
+                                                       allocator);
+}
+
+template <typename TMy, typename TOutput>
+template <typename TKeySelector, typename TExecutor>
+auto base_range<TMy, TOutput>::parallel_order_by(TKeySelector&&  key_selector,
+                                                 sort_direction sort_dir,
+                                                 TExecutor&     executor) const {
+  return order_by_range<TMy, TKeySelector>(static_cast<const TMy&>(*this),
+                                           std::forward<TKeySelector>(key_selector),
+                                           sort_dir,
+                                           executor_ref{executor});
+}
+
+template <typename TMy, typename TOutput>
+template <typename TKeySelector, typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_order_by(TKeySelector&&    key_selector,
+                                                 sort_direction    sort_dir,
+                                                 TExecutor&        executor,
+                                                 const TAllocator& allocator) const {
+  return order_by_range<TMy, TKeySelector, TAllocator>(static_cast<const TMy&>(*this),
+                                                       std::forward<TKeySelector>(key_selector),
+                                                       sort_dir,
+                                                       executor_ref{executor},
+                                                       allocator);
+}
+
 template <typename TMy, typename TOutput>
 template <typename TKeySelector>
 auto base_range<TMy, TOutput>::then_by(TKeySelector&& key_selector, sort_direction sort_dir) const {
@@ -1893,58 +6257,105 @@ auto base_range<TMy, TOutput>::then_by(TKeySelector&& key_selector, sort_directi
                                           sort_dir);
 }
 
+// Whether a range yields references that stay valid while it's iterated further, so that min() and max()
+// can keep the address of the best element and copy only that one. Elsewhere, a reference may point into
+// an iterator (e.g. of select_many) and be overwritten by the next element.
+template <typename TRange>
+inline constexpr bool has_stable_element_refs_v =
+    std::is_lvalue_reference_v<typename TRange::iterator::output_t> && (TRange::is_sliceable || TRange::owns_elements);
+
 template <typename TMy, typename TOutput>
 auto base_range<TMy, TOutput>::sum() const {
-  bool     first = true;
-  output_t result{};
-
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    if (first) {
-      result = p;
-      first  = false;
-    }
-    else {
-      result += p;
-    }
+  if constexpr (TMy::is_arithmetic_sequence) {
+    const auto& self = static_cast<const TMy&>(*this);
+    return self.slice_count() > 0 ? std::optional<output_t>{self.sequence_sum()} : std::optional<output_t>{};
   }
+  else {
+    bool     first = true;
+    output_t result{};
+
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (first) {
+        result = p;
+        first  = false;
+      }
+      else {
+        result += p;
+      }
+    }
 
-  return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+    return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+  }
 }
 
 template <typename TMy, typename TOutput>
 auto base_range<TMy, TOutput>::min() const {
-  bool     first = true;
-  output_t result{};
+  if constexpr (TMy::is_arithmetic_sequence) {
+    return first();
+  }
+  else if constexpr (has_stable_element_refs_v<TMy>) {
+    // Only copy the winner.
+    const output_t* result = nullptr;
 
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    if (first) {
-      result = p;
-      first  = false;
-    }
-    else if (p < result) {
-      result = p;
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (result == nullptr || p < *result) {
+        result = std::addressof(p);
+      }
     }
+
+    return result ? std::optional<output_t>{*result} : std::optional<output_t>{};
   }
+  else {
+    bool     first = true;
+    output_t result{};
+
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (first) {
+        result = p;
+        first  = false;
+      }
+      else if (p < result) {
+        result = p;
+      }
+    }
 
-  return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+    return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+  }
 }
 
 template <typename TMy, typename TOutput>
 auto base_range<TMy, TOutput>::max() const {
-  bool     first = true;
-  output_t result{};
+  if constexpr (TMy::is_arithmetic_sequence) {
+    return last();
+  }
+  else if constexpr (has_stable_element_refs_v<TMy>) {
+    // Only copy the winner.
+    const output_t* result = nullptr;
 
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    if (first) {
-      result = p;
-      first  = false;
-    }
-    else if (result < p) {
-      result = p;
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (result == nullptr || *result < p) {
+        result = std::addressof(p);
+      }
     }
+
+    return result ? std::optional<output_t>{*result} : std::optional<output_t>{};
   }
+  else {
+    bool     first = true;
+    output_t result{};
+
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (first) {
+        result = p;
+        first  = false;
+      }
+      else if (result < p) {
+        result = p;
+      }
+    }
 
-  return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+    return first ? std::optional<output_t>{} : std::optional<output_t>{result};
+  }
 }
 
 template <typename TMy, typename TOutput>
@@ -1974,7 +6385,7 @@ auto base_range<TMy, TOutput>::average() const
   requires(averageable<output_t> || number<output_t>)
 #endif
 {
-  return calculate_average<output_t>(static_cast<const TMy&>(*this));
+  return calculate_average<output_t>(sum_and_count());
 }
 
 template <typename TMy, typename TOutput>
@@ -1993,7 +6404,283 @@ auto base_range<TMy, TOutput>::aggregate(const TAccumFunc& func) const {
     }
   }
 
-  return sum;
+  return sum;
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_sum(TExecutor&& executor, const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<output_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<output_t>& partial, const auto& p) {
+          if (partial) {
+            *partial += p;
+          }
+          else {
+            partial.emplace(p);
+          }
+        },
+        [](output_t& result, output_t&& partial) { result += partial; },
+        allocator);
+  }
+  else {
+    return sum();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_min(TExecutor&& executor, const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<output_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<output_t>& partial, const auto& p) {
+          if (!partial || p < *partial) {
+            partial.emplace(p);
+          }
+        },
+        [](output_t& result, output_t&& partial) {
+          if (partial < result) {
+            result = std::move(partial);
+          }
+        },
+        allocator);
+  }
+  else {
+    return min();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_max(TExecutor&& executor, const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<output_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<output_t>& partial, const auto& p) {
+          if (!partial || *partial < p) {
+            partial.emplace(p);
+          }
+        },
+        [](output_t& result, output_t&& partial) {
+          if (result < partial) {
+            result = std::move(partial);
+          }
+        },
+        allocator);
+  }
+  else {
+    return max();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_sum_and_count(TExecutor&& executor, const TAllocator& allocator) const {
+  using sum_and_count_t = std::pair<output_t, size_t>;
+
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<sum_and_count_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<sum_and_count_t>& partial, const auto& p) {
+          if (partial) {
+            partial->first += p;
+            ++partial->second;
+          }
+          else {
+            partial.emplace(p, 1);
+          }
+        },
+        [](sum_and_count_t& result, sum_and_count_t&& partial) {
+          result.first += partial.first;
+          result.second += partial.second;
+        },
+        allocator);
+  }
+  else {
+    return sum_and_count();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_average(TExecutor&& executor, const TAllocator& allocator) const
+#ifdef __cpp_lib_concepts
+  requires(averageable<output_t> || number<output_t>)
+#endif
+{
+  return calculate_average<output_t>(parallel_sum_and_count(executor, allocator));
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_reproducible_sum(TExecutor&& executor, const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_tree_fold<output_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<output_t>& partial, const auto& p) {
+          if (partial) {
+            *partial += p;
+          }
+          else {
+            partial.emplace(p);
+          }
+        },
+        [](output_t& result, output_t&& partial) { result += partial; },
+        allocator);
+  }
+  else {
+    return sum();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_reproducible_sum_and_count(TExecutor&&       executor,
+                                                                   const TAllocator& allocator) const {
+  using sum_and_count_t = std::pair<output_t, size_t>;
+
+  if constexpr (TMy::is_sliceable) {
+    return parallel_tree_fold<sum_and_count_t>(
+        executor,
+        static_cast<const TMy&>(*this),
+        [](std::optional<sum_and_count_t>& partial, const auto& p) {
+          if (partial) {
+            partial->first += p;
+            ++partial->second;
+          }
+          else {
+            partial.emplace(p, 1);
+          }
+        },
+        [](sum_and_count_t& result, sum_and_count_t&& partial) {
+          result.first += partial.first;
+          result.second += partial.second;
+        },
+        allocator);
+  }
+  else {
+    return sum_and_count();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_reproducible_average(TExecutor&& executor, const TAllocator& allocator) const
+#ifdef __cpp_lib_concepts
+  requires(averageable<output_t> || number<output_t>)
+#endif
+{
+  return calculate_average<output_t>(parallel_reproducible_sum_and_count(executor, allocator));
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAccumFunc, typename TExecutor, typename TAllocator>
+auto base_range<TMy, TOutput>::parallel_aggregate(const TAccumFunc& func,
+                                                  TExecutor&&       executor,
+                                                  const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<output_t>(
+               executor,
+               static_cast<const TMy&>(*this),
+               [&func](std::optional<output_t>& partial, const auto& p) {
+                 if (partial) {
+                   partial = func(*partial, p);
+                 }
+                 else {
+                   partial.emplace(p);
+                 }
+               },
+               [&func](output_t& result, output_t&& partial) { result = func(result, partial); },
+               allocator)
+        .value_or(output_t{});
+  }
+  else {
+    return aggregate(func);
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TOperation, typename TExecutor, typename TAllocator>
+std::vector<typename base_range<TMy, TOutput>::output_t,
+            rebind_alloc_t<TAllocator, typename base_range<TMy, TOutput>::output_t>>
+base_range<TMy, TOutput>::parallel_scan(const TOperation& operation,
+                                        TExecutor&&       executor,
+                                        const TAllocator& allocator) const {
+  if constexpr (TMy::is_indexed) {
+    return parallel_indexed_scan<output_t, true>(executor, static_cast<const TMy&>(*this), operation, {}, allocator);
+  }
+  else {
+    return scan(operation).to_vector(allocator);
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TInit, typename TOperation, typename TExecutor, typename TAllocator>
+std::vector<TInit, rebind_alloc_t<TAllocator, TInit>>
+base_range<TMy, TOutput>::parallel_exclusive_scan(TInit             init,
+                                                  const TOperation& operation,
+                                                  TExecutor&&       executor,
+                                                  const TAllocator& allocator) const {
+  if constexpr (TMy::is_indexed) {
+    return parallel_indexed_scan<TInit, false>(executor,
+                                               static_cast<const TMy&>(*this),
+                                               operation,
+                                               std::optional<TInit>{std::move(init)},
+                                               allocator);
+  }
+  else {
+    return exclusive_scan(std::move(init), operation).to_vector(allocator);
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TExecutor, typename TAllocator, std::enable_if_t<is_executor_v<TExecutor>, int>>
+size_t base_range<TMy, TOutput>::parallel_count(TExecutor&& executor, const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<size_t>(
+               executor,
+               static_cast<const TMy&>(*this),
+               [](std::optional<size_t>& partial, const auto& p) {
+                 std::ignore = p;
+                 partial     = partial.value_or(0) + 1;
+               },
+               [](size_t& result, size_t&& partial) { result += partial; },
+               allocator)
+        .value_or(0);
+  }
+  else {
+    return count();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TPredicate, typename TExecutor, typename TAllocator>
+size_t base_range<TMy, TOutput>::parallel_count(const TPredicate& predicate,
+                                                TExecutor&&       executor,
+                                                const TAllocator& allocator) const {
+  if constexpr (TMy::is_sliceable) {
+    return parallel_fold<size_t>(
+               executor,
+               static_cast<const TMy&>(*this),
+               [&predicate](std::optional<size_t>& partial, const auto& p) {
+                 if (predicate(p)) {
+                   partial = partial.value_or(0) + 1;
+                 }
+               },
+               [](size_t& result, size_t&& partial) { result += partial; },
+               allocator)
+        .value_or(0);
+  }
+  else {
+    return count(predicate);
+  }
 }
 
 template <typename TMy, typename TOutput>
@@ -2020,32 +6707,122 @@ base_range<TMy, TOutput>::first(const TPredicate& predicate) const {
 
 template <typename TMy, typename TOutput>
 std::optional<typename base_range<TMy, TOutput>::output_t> base_range<TMy, TOutput>::last() const {
-  bool     have_any = false;
-  output_t ret{};
+  if constexpr (TMy::is_indexed) {
+    const auto&  self  = static_cast<const TMy&>(*this);
+    const size_t count = self.slice_count();
 
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    ret      = p;
-    have_any = true;
+    return count > 0 ? std::optional<output_t>{self.at(count - 1)} : std::optional<output_t>{};
   }
+  else {
+    std::optional<output_t> ret;
+
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      ret.emplace(p);
+    }
 
-  return have_any ? std::optional{ret} : std::optional<output_t>{};
+    return ret;
+  }
 }
 
 template <typename TMy, typename TOutput>
 template <typename TPredicate>
 std::optional<typename base_range<TMy, TOutput>::output_t>
 base_range<TMy, TOutput>::last(const TPredicate& predicate) const {
-  bool     have_any = false;
-  output_t ret{};
+  std::optional<output_t> ret;
 
   for (const auto& p : static_cast<const TMy&>(*this)) {
     if (predicate(p)) {
-      ret      = p;
-      have_any = true;
+      ret.emplace(p);
+    }
+  }
+
+  return ret;
+}
+
+// The pointer type that the *_ref functions of a range return.
+template <typename TRange>
+using element_pointer_t = std::add_pointer_t<std::remove_reference_t<typename TRange::iterator::output_t>>;
+
+template <typename TRange>
+constexpr void check_element_refs() {
+  static_assert(std::is_lvalue_reference_v<typename TRange::iterator::output_t>,
+                "first_ref, last_ref and element_at_ref require a range whose elements are references "
+                "(as opposed to computed values); use first, last or element_at instead.");
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::first_ref() const& {
+  return first_ref([](const auto&) { return true; });
+}
+
+template <typename TMy, typename TOutput>
+template <typename TPredicate>
+auto base_range<TMy, TOutput>::first_ref(const TPredicate& predicate) const& {
+  check_element_refs<TMy>();
+
+  for (auto&& p : static_cast<const TMy&>(*this)) {
+    if (predicate(p)) {
+      return element_pointer_t<TMy>{std::addressof(p)};
+    }
+  }
+
+  return element_pointer_t<TMy>{};
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::last_ref() const& {
+  check_element_refs<TMy>();
+
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_indexed) {
+    const size_t count = self.slice_count();
+    return count > 0 ? element_pointer_t<TMy>{std::addressof(self.at(count - 1))} : element_pointer_t<TMy>{};
+  }
+  else {
+    return last_ref([](const auto&) { return true; });
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TPredicate>
+auto base_range<TMy, TOutput>::last_ref(const TPredicate& predicate) const& {
+  check_element_refs<TMy>();
+
+  element_pointer_t<TMy> ret{};
+
+  for (auto&& p : static_cast<const TMy&>(*this)) {
+    if (predicate(p)) {
+      ret = std::addressof(p);
     }
   }
 
-  return have_any ? std::optional{ret} : std::optional<output_t>{};
+  return ret;
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::element_at_ref(size_t index) const& {
+  check_element_refs<TMy>();
+
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_indexed) {
+    return index < self.slice_count() ? element_pointer_t<TMy>{std::addressof(self.at(index))}
+                                      : element_pointer_t<TMy>{};
+  }
+  else {
+    size_t i{0};
+
+    for (auto&& p : self) {
+      if (i >= index) {
+        return element_pointer_t<TMy>{std::addressof(p)};
+      }
+
+      ++i;
+    }
+
+    return element_pointer_t<TMy>{};
+  }
 }
 
 template <typename TMy, typename TOutput>
@@ -2060,6 +6837,53 @@ bool base_range<TMy, TOutput>::any(const TPredicate& predicate) const {
   return false;
 }
 
+template <typename TMy, typename TOutput>
+template <typename TValue>
+bool base_range<TMy, TOutput>::contains(const TValue& value) const {
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_associative) {
+    const auto& container = self.container();
+    using container_t     = std::decay_t<decltype(container)>;
+
+    if constexpr (std::is_same_v<typename container_t::key_type, typename container_t::value_type>) {
+      const auto [begin, end] = container.equal_range(value);
+      return std::find(begin, end, value) != end;
+    }
+    else {
+      // The keys of the found elements are already equivalent to value.first.
+      const auto [begin, end] = container.equal_range(value.first);
+      return std::any_of(begin, end, [&value](const auto& p) { return p.second == value.second; });
+    }
+  }
+  else if constexpr (TMy::is_contiguous) {
+    const auto* data     = self.data();
+    const auto* data_end = data + self.slice_count();
+
+    return std::find_if(data, data_end, [&value](const auto& p) { return element_equals(p, value); }) != data_end;
+  }
+  else {
+    return any([&value](const auto& p) { return element_equals(p, value); });
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TKey>
+std::optional<typename base_range<TMy, TOutput>::output_t>
+base_range<TMy, TOutput>::find_key(const TKey& key) const {
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_associative) {
+    const auto& container = self.container();
+    const auto  it        = container.find(key);
+
+    return it != container.end() ? std::optional<output_t>{*it} : std::optional<output_t>{};
+  }
+  else {
+    return first([&key](const auto& p) { return element_key(p) == key; });
+  }
+}
+
 template <typename TMy, typename TOutput>
 template <typename TPredicate>
 bool base_range<TMy, TOutput>::all(const TPredicate& predicate) const {
@@ -2092,14 +6916,19 @@ bool base_range<TMy, TOutput>::none(const TPredicate& predicate) const {
 
 template <typename TMy, typename TOutput>
 size_t base_range<TMy, TOutput>::count() const {
-  size_t ret{0};
-
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    std::ignore = p;
-    ++ret;
+  if constexpr (TMy::is_indexed) {
+    return static_cast<const TMy&>(*this).slice_count();
   }
+  else {
+    size_t ret{0};
 
-  return ret;
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      std::ignore = p;
+      ++ret;
+    }
+
+    return ret;
+  }
 }
 
 template <typename TMy, typename TOutput>
@@ -2118,47 +6947,294 @@ size_t base_range<TMy, TOutput>::count(const TPredicate& predicate) const {
 
 template <typename TMy, typename TOutput>
 std::optional<typename base_range<TMy, TOutput>::output_t> base_range<TMy, TOutput>::element_at(size_t index) const {
-  size_t i{0};
+  if constexpr (TMy::is_indexed) {
+    const auto& self = static_cast<const TMy&>(*this);
+    return index < self.slice_count() ? std::optional<output_t>{self.at(index)} : std::optional<output_t>{};
+  }
+  else {
+    size_t i{0};
 
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    if (i >= index) {
-      return std::optional{p};
+    for (const auto& p : static_cast<const TMy&>(*this)) {
+      if (i >= index) {
+        return std::optional<output_t>{p};
+      }
+
+      ++i;
     }
 
-    ++i;
+    return std::optional<output_t>{};
   }
+}
 
-  return {};
+template <typename TMy, typename TOutput>
+std::vector<typename base_range<TMy, TOutput>::output_t> base_range<TMy, TOutput>::to_vector() const& {
+  return to_vector(std::allocator<output_t>());
 }
 
 template <typename TMy, typename TOutput>
-std::vector<typename base_range<TMy, TOutput>::output_t> base_range<TMy, TOutput>::to_vector() const {
-  std::vector<output_t> vec;
+std::vector<typename base_range<TMy, TOutput>::output_t> base_range<TMy, TOutput>::to_vector() && {
+  if constexpr (TMy::owns_elements) {
+    auto& elements = static_cast<TMy&>(*this).owned_elements();
 
-  for (const auto& p : static_cast<const TMy&>(*this)) {
-    vec.emplace_back(p);
+    if constexpr (std::is_same_v<std::decay_t<decltype(elements)>, std::vector<output_t>>) {
+      return std::move(elements);
+    }
+    else {
+      return std::vector<output_t>(std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+    }
+  }
+  else {
+    return std::as_const(*this).to_vector();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+std::vector<typename base_range<TMy, TOutput>::output_t,
+            rebind_alloc_t<TAllocator, typename base_range<TMy, TOutput>::output_t>>
+base_range<TMy, TOutput>::to_vector(const TAllocator& allocator) const {
+  std::vector<output_t, rebind_alloc_t<TAllocator, output_t>> vec(allocator);
+
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_indexed) {
+    vec.reserve(self.slice_count());
+  }
+
+  for (auto&& p : self) {
+    vec.emplace_back(std::forward<decltype(p)>(p));
   }
 
   return vec;
 }
 
 template <typename TMy, typename TOutput>
-auto base_range<TMy, TOutput>::to_map() const {
-  std::map<typename output_t::first_type, typename output_t::second_type> map;
+template <typename TPredicate>
+std::pair<std::vector<typename base_range<TMy, TOutput>::output_t>,
+          std::vector<typename base_range<TMy, TOutput>::output_t>>
+base_range<TMy, TOutput>::partition(const TPredicate& predicate) const {
+  std::pair<std::vector<output_t>, std::vector<output_t>> ret;
+  partition(predicate, ret.first, ret.second);
+  return ret;
+}
+
+template <typename TMy, typename TOutput>
+template <typename TPredicate, typename TAllocator>
+auto base_range<TMy, TOutput>::partition(const TPredicate& predicate, const TAllocator& allocator) const {
+  using vector_t = std::vector<output_t, rebind_alloc_t<TAllocator, output_t>>;
+
+  std::pair<vector_t, vector_t> ret{vector_t(allocator), vector_t(allocator)};
+  partition(predicate, ret.first, ret.second);
+  return ret;
+}
+
+template <typename TMy, typename TOutput>
+template <typename TPredicate, typename TMatching, typename TNonMatching>
+void base_range<TMy, TOutput>::partition(const TPredicate& predicate,
+                                         TMatching&        matching,
+                                         TNonMatching&     non_matching) const {
+  const auto& self = static_cast<const TMy&>(*this);
+
+  // Neither side is reserved: reserving the whole count in both would double the memory, and the
+  // split isn't known in advance. The containers grow geometrically instead.
+  for (auto&& p : self) {
+    if (predicate(std::as_const(p))) {
+      append_element(matching, std::forward<decltype(p)>(p));
+    }
+    else {
+      append_element(non_matching, std::forward<decltype(p)>(p));
+    }
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TContainer>
+TContainer& base_range<TMy, TOutput>::append_to(TContainer& container) const {
+  const auto& self = static_cast<const TMy&>(*this);
+
+  if constexpr (TMy::is_indexed) {
+    reserve_additional(container, self.slice_count());
+  }
+
+  for (auto&& p : self) {
+    append_element(container, std::forward<decltype(p)>(p));
+  }
+
+  return container;
+}
+
+template <typename TMy, typename TOutput>
+template <typename TContainer>
+TContainer& base_range<TMy, TOutput>::assign_to(TContainer& container) const {
+  container.clear();
+  return append_to(container);
+}
+
+// Appends an element to the result of string_join().
+template <typename T>
+void append_joined(std::string& out, const T& value) {
+  if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    out.append(std::string_view(value));
+  }
+  else if constexpr (std::is_same_v<T, char>) {
+    out.push_back(value);
+  }
+  else {
+    std::array<char, 64> buffer;
+
+    const auto [end, error] = format_number(buffer.data(), buffer.data() + buffer.size(), value, float_format{});
+    assert(error == std::errc{} && "number too long for string_join");
+    (void)error;
+
+    out.append(buffer.data(), end);
+  }
+}
+
+template <typename TMy, typename TOutput>
+std::string base_range<TMy, TOutput>::string_join(std::string_view separator) const {
+  using element_t = std::decay_t<typename TMy::iterator::output_t>;
+
+  const auto& self = static_cast<const TMy&>(*this);
+  std::string ret;
+
+  // Measuring strings in plain storage is cheap, so do that first and allocate once. Other ranges are
+  // only iterated once, because iterating them again would repeat their work (e.g. sorting or filtering).
+  if constexpr (TMy::is_contiguous && std::is_convertible_v<const element_t&, std::string_view>) {
+    size_t length = 0;
+    size_t count  = 0;
+
+    for (const auto& p : self) {
+      length += std::string_view(p).size();
+      ++count;
+    }
+
+    ret.reserve(length + (count > 0 ? (count - 1) * separator.size() : 0));
+  }
+  else if constexpr (TMy::is_indexed) {
+    const size_t count = self.slice_count();
+    ret.reserve(count > 0 ? (count - 1) * separator.size() : 0);
+  }
+
+  bool first = true;
+
+  for (const auto& p : self) {
+    if (!first) {
+      ret.append(separator);
+    }
+
+    append_joined(ret, p);
+    first = false;
+  }
+
+  return ret;
+}
+
+template <typename TMy, typename TOutput>
+template <typename TFormatter>
+std::string base_range<TMy, TOutput>::string_join(std::string_view separator, const TFormatter& formatter) const {
+  using element_t = typename TMy::iterator::output_t;
 
-  for (const auto& [first, second] : static_cast<const TMy&>(*this)) {
-    map.emplace(first, second);
+  const auto& self = static_cast<const TMy&>(*this);
+  std::string ret;
+
+  if constexpr (TMy::is_indexed) {
+    const size_t count = self.slice_count();
+    ret.reserve(count > 0 ? (count - 1) * separator.size() : 0);
+  }
+
+  bool first = true;
+
+  for (const auto& p : self) {
+    if (!first) {
+      ret.append(separator);
+    }
+
+    if constexpr (std::is_invocable_v<const TFormatter&, std::string&, const element_t&>) {
+      formatter(ret, p);
+    }
+    else {
+      ret += formatter(p);
+    }
+
+    first = false;
+  }
+
+  return ret;
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::to_map() const& {
+  return to_map(std::allocator<output_t>());
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::to_map() && {
+  if constexpr (TMy::owns_elements) {
+    std::map<typename output_t::first_type, typename output_t::second_type> map;
+
+    for (auto& p : static_cast<TMy&>(*this).owned_elements()) {
+      map.emplace(std::move(p));
+    }
+
+    return map;
+  }
+  else {
+    return std::as_const(*this).to_map();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::to_map(const TAllocator& allocator) const {
+  using key_t   = typename output_t::first_type;
+  using value_t = typename output_t::second_type;
+
+  std::map<key_t, value_t, std::less<key_t>, rebind_alloc_t<TAllocator, std::pair<const key_t, value_t>>> map(
+      allocator);
+
+  for (auto&& p : static_cast<const TMy&>(*this)) {
+    map.emplace(std::forward<decltype(p)>(p));
   }
 
   return map;
 }
 
 template <typename TMy, typename TOutput>
-auto base_range<TMy, TOutput>::to_unordered_map() const {
-  std::unordered_map<typename output_t::first_type, typename output_t::second_type> map;
+auto base_range<TMy, TOutput>::to_unordered_map() const& {
+  return to_unordered_map(std::allocator<output_t>());
+}
+
+template <typename TMy, typename TOutput>
+auto base_range<TMy, TOutput>::to_unordered_map() && {
+  if constexpr (TMy::owns_elements) {
+    std::unordered_map<typename output_t::first_type, typename output_t::second_type> map;
 
-  for (const auto& [first, second] : static_cast<const TMy&>(*this)) {
-    map.emplace(first, second);
+    for (auto& p : static_cast<TMy&>(*this).owned_elements()) {
+      map.emplace(std::move(p));
+    }
+
+    return map;
+  }
+  else {
+    return std::as_const(*this).to_unordered_map();
+  }
+}
+
+template <typename TMy, typename TOutput>
+template <typename TAllocator>
+auto base_range<TMy, TOutput>::to_unordered_map(const TAllocator& allocator) const {
+  using key_t   = typename output_t::first_type;
+  using value_t = typename output_t::second_type;
+
+  std::unordered_map<key_t,
+                     value_t,
+                     std::hash<key_t>,
+                     std::equal_to<key_t>,
+                     rebind_alloc_t<TAllocator, std::pair<const key_t, value_t>>>
+      map(allocator);
+
+  for (auto&& p : static_cast<const TMy&>(*this)) {
+    map.emplace(std::forward<decltype(p)>(p));
   }
 
   return map;
@@ -2205,11 +7281,23 @@ template <template <class, size_t> class C, typename T, size_t L>
   return details::container_range<C<T, L>>{container};
 }
 
-// std::map
+// std::map, std::unordered_set
 
 template <template <class, class, class, class> class C, typename K, typename T, typename S, typename U>
 [[nodiscard]] static auto from(const C<K, T, S, U>* container) {
-  return details::container_range<C<K, T, S, U>>{container};
+  return details::container_range_t<C<K, T, S, U>>{container};
+}
+
+// std::unordered_map
+
+template <template <class, class, class, class, class> class C,
+          typename K,
+          typename T,
+          typename H,
+          typename E,
+          typename U>
+[[nodiscard]] static auto from(const C<K, T, H, E, U>* container) {
+  return details::container_range_t<C<K, T, H, E, U>>{container};
 }
 
 // misc container
@@ -2242,13 +7330,25 @@ template <template <class, size_t> class C, typename T, size_t L>
   return details::mutable_container_range<C<T, L>>{container};
 }
 
-// std::map
+// std::map, std::unordered_set
 
 template <template <class, class, class, class> class C, typename K, typename T, typename S, typename U>
 [[nodiscard]] static auto from_mutable(C<K, T, S, U>* container) {
   return details::mutable_container_range<C<K, T, S, U>>{container};
 }
 
+// std::unordered_map
+
+template <template <class, class, class, class, class> class C,
+          typename K,
+          typename T,
+          typename H,
+          typename E,
+          typename U>
+[[nodiscard]] static auto from_mutable(C<K, T, H, E, U>* container) {
+  return details::mutable_container_range<C<K, T, H, E, U>>{container};
+}
+
 // misc container
 
 template <template <typename> typename C, class T>
@@ -2256,9 +7356,56 @@ template <template <typename> typename C, class T>
   return details::mutable_container_range<C<T>>{container};
 }
 
+// Contiguous memory
+
+/**
+ * @brief Creates a non-owning range over count elements starting at data.
+ *
+ * Example:
+ * @code{.cpp}
+ * const float* samples = device.map();
+ * auto peak = linq::from(samples, sample_count).max();
+ * @endcode
+ */
+template <typename T>
+[[nodiscard]] static auto from(const T* data, size_t count) {
+  return details::pointer_range<const T>{data, count};
+}
+
+/**
+ * @brief Creates a non-owning range over a C array.
+ */
+template <typename T, size_t N>
+[[nodiscard]] static auto from(const T (&array)[N]) {
+  return details::pointer_range<const T>{array, N};
+}
+
+#ifdef __cpp_lib_span
+/**
+ * @brief Creates a non-owning range over the elements of a span.
+ */
+template <typename T, size_t Extent>
+[[nodiscard]] static auto from(std::span<T, Extent> span) {
+  return details::pointer_range<const T>{span.data(), span.size()};
+}
+#endif
+
+/**
+ * @brief Creates a non-owning range over count mutable elements starting at data.
+ */
+template <typename T>
+[[nodiscard]] static auto from_mutable(T* data, size_t count) {
+  return details::pointer_range<T>{data, count};
+}
+
+template <typename T, size_t N>
+[[nodiscard]] static auto from_mutable(T (&array)[N]) {
+  return details::pointer_range<T>{array, N};
+}
+
 template <typename TContainer>
-[[nodiscard]] static auto from_copy(const TContainer& container) {
-  return details::container_copy_range<TContainer>{container};
+[[nodiscard]] static auto from_copy(TContainer container) {
+  return details::container_copy_range<TContainer>{std::move(container)};
 }
 
 template <typename T>
@@ -2266,6 +7413,19 @@ template <typename T>
   return details::initializer_list_range<T>{list};
 }
 
+/**
+ * @brief Same as from(list), but the copy of the list is allocated from an allocator.
+ */
+template <typename T, typename TAllocator>
+[[nodiscard]] static auto from(std::initializer_list<T> list, const TAllocator& allocator) {
+  using allocator_t = details::rebind_alloc_t<TAllocator, T>;
+  return details::initializer_list_range<T, allocator_t>{list, allocator_t(allocator)};
+}
+
+/**
+ * @brief Yields start, start + step, start + 2 * step and so on, up to and including end.
+ * @throws std::invalid_argument if step isn't positive
+ */
 template <typename T>
 #ifdef __cpp_lib_concepts
   requires(details::addable<T> || details::number<T>)
@@ -2279,6 +7439,39 @@ template <typename TGenerator>
   return details::generator_range<TGenerator>{std::forward<TGenerator>(generator)};
 }
 
+/**
+ * @brief Creates a range of count elements, where the element at index i is generator(i).
+ * The generator must be a pure function of the index, since elements may be computed in any
+ * order, more than once or in parallel. In exchange, the range supports the parallel operators
+ * and constant-time skip() and element_at().
+ *
+ * Example:
+ * @code{.cpp}
+ * auto samples = linq::generate_indexed(1024, [](size_t i) { return std::sin(i * 0.01); });
+ * @endcode
+ */
+template <typename TGenerator>
+[[nodiscard]] static auto generate_indexed(size_t count, TGenerator&& generator) {
+  return details::indexed_generator_range<std::decay_t<TGenerator>>{count, std::forward<TGenerator>(generator)};
+}
+
+#ifdef __cpp_lib_coroutine
+/**
+ * @brief Creates a range over the elements that a generator coroutine yields (see linq::generator).
+ * The elements are references to the values that the coroutine yields. The range can only be
+ * iterated once.
+ *
+ * Example:
+ * @code{.cpp}
+ * auto words = linq::from_coroutine(split(text, ' ')).where([](std::string_view w) { return w.size() > 3; });
+ * @endcode
+ */
+template <typename T>
+[[nodiscard]] static auto from_coroutine(generator<T> coroutine) {
+  return details::coroutine_range<T>{std::move(coroutine)};
+}
+#endif
+
 template <typename T>
 [[nodiscard]] static details::generator_return_value<T> generate_return(T&& value) {
   return details::generator_return_value{std::forward<T>(value)};
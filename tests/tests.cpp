@@ -1,7 +1,17 @@
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
 #include <linq.hpp>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <span>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #ifdef __GNUC__
@@ -624,6 +634,10 @@ TEST_CASE("min") {
   REQUIRE(linq::from(&doubles).min() == -20.0);
   REQUIRE(!linq::from(&doubles).where([](double value) { return value > 20; }).min().has_value());
   REQUIRE(linq::from(&doubles).where([](double value) { return value > 1; }).min() == 3.25);
+
+  // The elements of select_many are references into its iterator, which are overwritten as it advances.
+  const std::vector starts{-5, 0};
+  REQUIRE(linq::from(&starts).select_many([](int i) { return linq::from({i, i + 1}); }).min() == -5);
 }
 
 TEST_CASE("max") {
@@ -644,6 +658,9 @@ TEST_CASE("max") {
   REQUIRE(linq::from(&doubles).max() == 5.0);
   REQUIRE(!linq::from(&doubles).where([](double value) { return value > 10; }).max().has_value());
   REQUIRE(linq::from(&doubles).where([](double value) { return value < 8; }).max() == 5.0);
+
+  const std::vector starts{5, 0};
+  REQUIRE(linq::from(&starts).select_many([](int i) { return linq::from({i, i + 1}); }).max() == 6);
 }
 
 TEST_CASE("average") {
@@ -798,3 +815,1648 @@ TEST_CASE("to_unordered_map") {
   REQUIRE(map.at("b") == 2);
   REQUIRE(map.at("c") == 1);
 }
+
+TEST_CASE("parallel aggregation") {
+  std::vector<int> numbers(100000);
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    numbers[i] = static_cast<int>(i % 1000) - 500;
+  }
+
+  const auto query = linq::from(&numbers);
+
+  SECTION("sum, min, max, count") {
+    REQUIRE(query.parallel_sum() == query.sum());
+    REQUIRE(query.parallel_min() == query.min());
+    REQUIRE(query.parallel_max() == query.max());
+    REQUIRE(query.parallel_count() == numbers.size());
+    REQUIRE(query.parallel_count([](int i) { return i > 0; }) == query.count([](int i) { return i > 0; }));
+    REQUIRE(query.parallel_sum_and_count() == query.sum_and_count());
+    REQUIRE(query.parallel_average() == query.average());
+  }
+
+  SECTION("through where and select") {
+    const auto filtered = query.where([](int i) { return i % 3 == 0; }).select([](int i) { return int64_t{i} * 2; });
+
+    REQUIRE(filtered.parallel_sum() == filtered.sum());
+    REQUIRE(filtered.parallel_max() == filtered.max());
+    REQUIRE(filtered.parallel_count() == filtered.count());
+    REQUIRE(filtered.parallel_aggregate([](int64_t a, int64_t b) { return a + b; }) ==
+            filtered.aggregate([](int64_t a, int64_t b) { return a + b; }));
+  }
+
+  SECTION("empty and non-sliceable ranges") {
+    const std::vector<int> empty;
+
+    REQUIRE(linq::from(&empty).parallel_sum().has_value() == false);
+    REQUIRE(linq::from(&empty).parallel_count() == 0);
+    REQUIRE(linq::from_to(1, 10).parallel_sum() == 55);
+  }
+
+  SECTION("nested parallel queries") {
+    const auto outer = linq::from(&numbers).select([&](int i) { return i > 495 ? query.parallel_count() : size_t{1}; });
+
+    REQUIRE(outer.parallel_count() == numbers.size());
+    REQUIRE(outer.parallel_max() == numbers.size());
+  }
+}
+
+TEST_CASE("parallel_order_by") {
+  std::vector<person> people;
+  for (int i = 0; i < 50000; ++i) {
+    people.push_back(person{.name = "P" + std::to_string(i), .age = (i * 7919) % 100});
+  }
+
+  const auto by_age  = [](const person& p) { return p.age; };
+  const auto by_name = [](const person& p) { return p.name; };
+
+  const auto sequential = linq::from(&people).order_by_ascending(by_age).to_vector();
+  const auto parallel   = linq::from(&people).parallel_order_by_ascending(by_age).to_vector();
+
+  REQUIRE(sequential.size() == parallel.size());
+  REQUIRE(linq::from(&sequential).select(by_name).to_vector() == linq::from(&parallel).select(by_name).to_vector());
+
+  const auto then_sequential = linq::from(&people).order_by_descending(by_age).then_by_ascending(by_name).to_vector();
+  const auto then_parallel =
+      linq::from(&people).parallel_order_by_descending(by_age).then_by_ascending(by_name).to_vector();
+
+  REQUIRE(linq::from(&then_sequential).select(by_name).to_vector() ==
+          linq::from(&then_parallel).select(by_name).to_vector());
+}
+
+// An executor that forwards to another one and records how it was used.
+struct counting_executor {
+  size_t concurrency() const {
+    return 3;
+  }
+
+  template <typename TFunc>
+  void bulk(size_t task_count, const TFunc& func) {
+    ++bulk_calls;
+    max_task_count = std::max(max_task_count, task_count);
+    linq::inline_executor{}.bulk(task_count, func);
+  }
+
+  size_t bulk_calls{};
+  size_t max_task_count{};
+};
+
+static_assert(linq::executor<linq::thread_pool>);
+static_assert(linq::executor<linq::inline_executor>);
+static_assert(linq::executor<counting_executor>);
+
+TEST_CASE("executors") {
+  std::vector<int> numbers(10000);
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    numbers[i] = static_cast<int>(i);
+  }
+
+  const auto query    = linq::from(&numbers).where([](int i) { return i % 2 == 0; });
+  const auto is_small = [](int i) { return i < 100; };
+
+  SECTION("inline executor") {
+    const linq::inline_executor executor;
+
+    REQUIRE(query.parallel_sum(executor) == query.sum());
+    REQUIRE(query.parallel_min(executor) == query.min());
+    REQUIRE(query.parallel_max(executor) == query.max());
+    REQUIRE(query.parallel_count(executor) == query.count());
+    REQUIRE(query.parallel_count(is_small, executor) == query.count(is_small));
+    REQUIRE(query.parallel_average(executor) == query.average());
+    REQUIRE(query.parallel_aggregate([](int a, int b) { return std::max(a, b); }, linq::inline_executor{}) == 9998);
+  }
+
+  SECTION("custom executor") {
+    counting_executor executor;
+
+    REQUIRE(query.parallel_sum(executor) == query.sum());
+    REQUIRE(executor.bulk_calls == 1);
+    REQUIRE(executor.max_task_count <= executor.concurrency());
+  }
+
+  SECTION("private thread pool") {
+    linq::thread_pool pool{2};
+
+    REQUIRE(pool.concurrency() == 3);
+    REQUIRE(query.parallel_sum(pool) == query.sum());
+    REQUIRE(query.parallel_count(is_small, pool) == 50);
+
+    const auto sorted = linq::from(&numbers).parallel_order_by_descending([](int i) { return i; }, pool).to_vector();
+    REQUIRE(sorted.front() == 9999);
+    REQUIRE(sorted.back() == 0);
+  }
+}
+
+TEST_CASE("parallel_reproducible_sum") {
+  std::vector<double> values(200000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = 1.0 / static_cast<double>(i + 1) * ((i % 3 == 0) ? -1e6 : 1e-3);
+  }
+
+  const auto query = linq::from(&values).where([](double d) { return d != 0.5; });
+
+  const auto reference     = query.parallel_reproducible_sum(linq::inline_executor{}).value();
+  const auto reference_avg = query.parallel_reproducible_average(linq::inline_executor{}).value();
+
+  for (size_t workers = 0; workers < 5; ++workers) {
+    linq::thread_pool pool{workers};
+
+    for (int run = 0; run < 3; ++run) {
+      REQUIRE(query.parallel_reproducible_sum(pool).value() == reference);
+      REQUIRE(query.parallel_reproducible_average(pool).value() == reference_avg);
+    }
+  }
+
+  REQUIRE(query.parallel_reproducible_sum_and_count()->second == values.size());
+
+  const std::vector<double> empty;
+  REQUIRE(linq::from(&empty).parallel_reproducible_sum().has_value() == false);
+}
+
+TEST_CASE("chunk") {
+  SECTION("contiguous source") {
+    const std::vector numbers{1, 2, 3, 4, 5, 6, 7};
+
+    std::vector<std::vector<int>> chunks;
+    for (const auto& chunk : linq::from(&numbers).chunk(3)) {
+      chunks.emplace_back(chunk.begin(), chunk.end());
+    }
+
+    REQUIRE(chunks == std::vector<std::vector<int>>{{1, 2, 3}, {4, 5, 6}, {7}});
+
+    // The chunks view the container itself.
+    const auto first_chunk = linq::from(&numbers).chunk(3).first().value();
+    REQUIRE(first_chunk.data() == numbers.data());
+    REQUIRE(first_chunk.size() == 3);
+
+    const std::span<const int> span = first_chunk;
+    REQUIRE(span.size() == 3);
+  }
+
+  SECTION("buffered source") {
+    const std::vector numbers{1, 2, 3, 4, 5, 6, 7, 8};
+
+    std::vector<std::vector<int>> chunks;
+    for (const auto& chunk : linq::from(&numbers).where([](int i) { return i != 4; }).chunk(2)) {
+      chunks.emplace_back(chunk.begin(), chunk.end());
+    }
+
+    REQUIRE(chunks == std::vector<std::vector<int>>{{1, 2}, {3, 5}, {6, 7}, {8}});
+    REQUIRE(linq::from(&numbers).select([](int i) { return i * 2; }).chunk(3).count() == 3);
+  }
+
+  SECTION("empty source") {
+    const std::vector<int> empty;
+
+    REQUIRE(linq::from(&empty).chunk(4).count() == 0);
+    REQUIRE(linq::from(&empty).where([](int) { return true; }).chunk(4).count() == 0);
+  }
+
+  SECTION("zero size") {
+    const std::vector numbers{1, 2, 3};
+
+    REQUIRE_THROWS_AS((void)linq::from(&numbers).chunk(0), std::invalid_argument);
+    REQUIRE_THROWS_AS((void)linq::from(&numbers).where([](int) { return true; }).chunk(0), std::invalid_argument);
+  }
+
+  SECTION("size larger than the source") {
+    const std::list<int> list{1, 2, 3};
+    const size_t         huge = size_t{1} << 40;
+
+    // The buffer only grows as large as the chunks really are.
+    REQUIRE(linq::from(&list).chunk(huge).select([](auto c) { return c.size(); }).to_vector() == std::vector<size_t>{3});
+    REQUIRE(linq::from_to(1, 3).chunk(huge).count() == 1);
+  }
+}
+
+TEST_CASE("zip") {
+  const std::vector numbers{1, 2, 3, 4};
+  const std::vector words{"one"s, "two"s, "three"s};
+
+  SECTION("tuples") {
+    const auto query = linq::from(&numbers).zip(linq::from(&words));
+
+    REQUIRE(query.count() == 3);
+
+    std::vector<std::string> lines;
+    for (const auto& [number, word] : query) {
+      lines.push_back(std::to_string(number) + word);
+    }
+
+    REQUIRE(lines == std::vector{"1one"s, "2two"s, "3three"s});
+
+    // Elements that are yielded by reference stay references.
+    const auto first = query.first().value();
+    REQUIRE(&std::get<1>(first) == &words.at(0));
+  }
+
+  SECTION("more than two ranges, not indexed") {
+    const auto odd   = linq::from(&numbers).where([](int i) { return i % 2 != 0; });
+    const auto query = odd.zip(linq::from(&numbers), linq::from(&words));
+
+    REQUIRE(query.count() == 2);
+    REQUIRE(std::get<0>(query.last().value()) == 3);
+    REQUIRE(std::get<2>(query.last().value()) == "two");
+  }
+
+  SECTION("temporaries that store their elements") {
+    // The tuples outlive the zipped copies of both initializer lists, so they hold values.
+    const auto pairs = linq::from({1, 2, 3}).zip(linq::from({4, 5, 6})).to_vector();
+
+    REQUIRE(pairs == std::vector{std::tuple{1, 4}, std::tuple{2, 5}, std::tuple{3, 6}});
+
+    const auto mixed = linq::from(&words).zip(linq::from({7, 8})).to_vector();
+
+    REQUIRE(std::get<0>(mixed.at(1)) == "two");
+    REQUIRE(std::get<1>(mixed.at(1)) == 8);
+  }
+
+  SECTION("zip_with") {
+    const std::vector a{1.0, 2.0, 3.0, 4.0};
+    const std::vector b{2.0, 2.0, 2.0, 2.0};
+    const std::vector c{0.5, 0.5, 0.5, 0.5};
+
+    const auto query = linq::from(&a)
+                           .zip_with(linq::from(&b), [](double x, double y) { return x * y; })
+                           .zip_with(linq::from(&c), [](double xy, double z) { return xy + z; });
+
+    REQUIRE(query.to_vector() == std::vector{2.5, 4.5, 6.5, 8.5});
+    REQUIRE(query.sum() == 22.0);
+    REQUIRE(query.parallel_sum(linq::inline_executor{}) == 22.0);
+  }
+}
+
+TEST_CASE("scan") {
+  const std::vector numbers{1, 2, 3, 4, 5};
+  const auto        plus = [](int a, int b) { return a + b; };
+
+  SECTION("inclusive") {
+    const auto query = linq::from(&numbers).scan(plus);
+
+    REQUIRE(query.to_vector() == std::vector{1, 3, 6, 10, 15});
+
+    // Iterating a second time starts over.
+    REQUIRE(query.to_vector() == std::vector{1, 3, 6, 10, 15});
+  }
+
+  SECTION("exclusive") {
+    const auto query = linq::from(&numbers).exclusive_scan(size_t{100}, plus);
+
+    REQUIRE(query.to_vector() == std::vector<size_t>{100, 101, 103, 106, 110});
+  }
+
+  SECTION("empty") {
+    const std::vector<int> empty;
+
+    REQUIRE(linq::from(&empty).scan(plus).count() == 0);
+    REQUIRE(linq::from(&empty).exclusive_scan(0, plus).count() == 0);
+    REQUIRE(linq::from(&empty).parallel_scan(plus).empty());
+  }
+
+  SECTION("parallel") {
+    std::vector<int64_t> values(100000);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<int64_t>(i % 17) - 8;
+    }
+
+    const auto query = linq::from(&values);
+    const auto add   = [](int64_t a, int64_t b) { return a + b; };
+
+    REQUIRE(query.parallel_scan(add) == query.scan(add).to_vector());
+    REQUIRE(query.parallel_exclusive_scan(int64_t{5}, add) == query.exclusive_scan(int64_t{5}, add).to_vector());
+
+    linq::thread_pool pool{3};
+    REQUIRE(query.parallel_scan(add, pool) == query.scan(add).to_vector());
+
+    // Non-indexed ranges are scanned sequentially.
+    const auto odd = query.where([](int64_t i) { return i % 2 != 0; });
+    REQUIRE(odd.parallel_scan(add, pool) == odd.scan(add).to_vector());
+  }
+}
+
+TEST_CASE("window") {
+  const std::vector numbers{4, 1, 3, 5, 2, 6};
+
+  SECTION("contiguous") {
+    const auto windows = linq::from(&numbers).window(3).select([](auto w) { return std::vector(w.begin(), w.end()); });
+
+    REQUIRE(windows.to_vector() == std::vector<std::vector<int>>{{4, 1, 3}, {1, 3, 5}, {3, 5, 2}, {5, 2, 6}});
+    REQUIRE(linq::from(&numbers).window(3).first()->data() == numbers.data());
+  }
+
+  SECTION("buffered") {
+    const auto windows = linq::from(&numbers)
+                             .where([](int i) { return i != 3; })
+                             .window(2)
+                             .select([](auto w) { return std::vector(w.begin(), w.end()); });
+
+    REQUIRE(windows.to_vector() == std::vector<std::vector<int>>{{4, 1}, {1, 5}, {5, 2}, {2, 6}});
+    REQUIRE(windows.count() == 4);
+  }
+
+  SECTION("too short") {
+    REQUIRE(linq::from(&numbers).window(7).count() == 0);
+    REQUIRE(linq::from(&numbers).where([](int i) { return i > 4; }).window(3).count() == 0);
+    REQUIRE(linq::from(&numbers).window(6).count() == 1);
+  }
+
+  SECTION("rolling sum and average") {
+    const auto query = linq::from(&numbers);
+
+    REQUIRE(query.window_aggregate(3, linq::rolling_sum{}).to_vector() == std::vector{8, 9, 10, 13});
+    REQUIRE(query.window_aggregate(2, linq::rolling_average{}).to_vector() ==
+            std::vector<long double>{2.5L, 2.0L, 4.0L, 3.5L, 4.0L});
+  }
+
+  SECTION("rolling min and max") {
+    const auto query = linq::from(&numbers).where([](int) { return true; });
+
+    REQUIRE(query.window_aggregate(3, linq::rolling_min{}).to_vector() == std::vector{1, 1, 2, 2});
+    REQUIRE(query.window_aggregate(3, linq::rolling_max{}).to_vector() == std::vector{4, 5, 5, 6});
+    REQUIRE(query.window_aggregate(1, linq::rolling_max{}).to_vector() == numbers);
+
+    // Duplicates leave the window one at a time.
+    const std::vector same{2, 2, 2, 1, 2};
+    REQUIRE(linq::from(&same).window_aggregate(2, linq::rolling_min{}).to_vector() == std::vector{2, 2, 1, 1});
+  }
+
+  SECTION("matches naive") {
+    std::vector<int> values(1000);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<int>((i * 7919) % 101);
+    }
+
+    const auto rolling_max = linq::from(&values).window_aggregate(17, linq::rolling_max{}).to_vector();
+    const auto naive_max   = linq::from(&values).window(17).select([](auto w) {
+      return *std::max_element(w.begin(), w.end());
+    });
+
+    REQUIRE(rolling_max == naive_max.to_vector());
+  }
+
+  SECTION("custom aggregation") {
+    struct product {
+      void push(int i) {
+        value *= i;
+      }
+
+      void pop(int i) {
+        value /= i;
+      }
+
+      int result() const {
+        return value;
+      }
+
+      int value = 1;
+    };
+
+    REQUIRE(linq::from(&numbers).window_aggregate(2, product{}).to_vector() == std::vector{4, 3, 15, 10, 12});
+  }
+
+  SECTION("zero size") {
+    REQUIRE_THROWS_AS((void)linq::from(&numbers).window(0), std::invalid_argument);
+    REQUIRE_THROWS_AS((void)linq::from(&numbers).where([](int) { return true; }).window(0), std::invalid_argument);
+    REQUIRE_THROWS_AS((void)linq::from(&numbers).window_aggregate(0, linq::rolling_sum{}), std::invalid_argument);
+  }
+
+  SECTION("size larger than the source") {
+    const std::list<int> list{1, 2, 3};
+    const size_t         huge = size_t{1} << 40;
+
+    REQUIRE(linq::from(&list).window(huge).count() == 0);
+    REQUIRE(linq::from(&list).window(std::numeric_limits<size_t>::max()).count() == 0);
+    REQUIRE(linq::from_to(1, 3).window(huge).count() == 0);
+  }
+
+  SECTION("elements without a default constructor") {
+    struct value {
+      explicit value(int i)
+          : i(i) {
+      }
+
+      int i;
+    };
+
+    const std::list<value> list{value{1}, value{2}, value{3}, value{4}, value{5}};
+
+    const auto firsts = linq::from(&list).window(2).select([](auto w) { return w[0].i; });
+    REQUIRE(firsts.to_vector() == std::vector{1, 2, 3, 4});
+  }
+}
+
+TEST_CASE("partition") {
+  const std::vector numbers{1, 2, 3, 4, 5, 6, 7};
+  const auto        is_even = [](int i) { return i % 2 == 0; };
+
+  SECTION("vectors") {
+    const auto [even, odd] = linq::from(&numbers).partition(is_even);
+
+    REQUIRE(even == std::vector{2, 4, 6});
+    REQUIRE(odd == std::vector{1, 3, 5, 7});
+  }
+
+  SECTION("single pass") {
+    int        calls = 0;
+    const auto query = linq::from(&numbers).select([&calls](int i) {
+      ++calls;
+      return i * 10;
+    });
+
+    const auto [big, small] = query.partition([](int i) { return i > 40; });
+
+    REQUIRE(calls == 7);
+    REQUIRE(big == std::vector{50, 60, 70});
+    REQUIRE(small == std::vector{10, 20, 30, 40});
+  }
+
+  SECTION("into containers") {
+    std::vector<int> even{100};
+    std::set<int>    odd{100};
+
+    linq::from(&numbers).where([](int i) { return i > 2; }).partition(is_even, even, odd);
+
+    REQUIRE(even == std::vector{100, 4, 6});
+    REQUIRE(odd == std::set{3, 5, 7, 100});
+  }
+
+  SECTION("empty") {
+    const std::vector<int> empty;
+    const auto [even, odd] = linq::from(&empty).partition(is_even);
+
+    REQUIRE(even.empty());
+    REQUIRE(odd.empty());
+  }
+}
+
+TEST_CASE("tee") {
+  const std::vector numbers{1, 2, 3, 4, 5, 6};
+
+  int        calls = 0;
+  const auto query = linq::from(&numbers).select([&calls](int i) {
+    ++calls;
+    return i * 10;
+  });
+
+  SECTION("consumed one after another") {
+    calls = 0;
+
+    auto [a, b, c] = query.tee<3>();
+
+    REQUIRE(a.sum() == 210);
+    REQUIRE(b.where([](int i) { return i > 30; }).count() == 3);
+    REQUIRE(c.max() == 60);
+    REQUIRE(calls == 6);
+  }
+
+  SECTION("consumed in lockstep") {
+    calls = 0;
+
+    auto [a, b] = query.tee<2>();
+
+    const auto pairs = a.zip_with(b.skip(1), [](int x, int y) { return y - x; }).to_vector();
+
+    REQUIRE(pairs == std::vector{10, 10, 10, 10, 10});
+    REQUIRE(calls == 6);
+  }
+
+  SECTION("unused consumer") {
+    calls = 0;
+
+    auto [a, b] = query.tee<2>();
+
+    REQUIRE(a.to_vector() == std::vector{10, 20, 30, 40, 50, 60});
+    REQUIRE(calls == 6);
+  }
+
+  SECTION("empty") {
+    const std::vector<int> empty;
+    auto [a, b] = linq::from(&empty).tee<2>();
+
+    REQUIRE(a.count() == 0);
+    REQUIRE(!b.first().has_value());
+  }
+}
+
+TEST_CASE("allocators") {
+  // Fails every allocation that doesn't come from the arena.
+  std::array<std::byte, 16384>        storage{};
+  std::pmr::monotonic_buffer_resource arena{storage.data(), storage.size(), std::pmr::null_memory_resource()};
+  const std::pmr::polymorphic_allocator<std::byte> allocator{&arena};
+
+  const std::vector numbers{3, 1, 4, 1, 5, 9, 2, 6};
+  const auto        query = linq::from(&numbers);
+
+  SECTION("buffering operators") {
+    REQUIRE(query.distinct(allocator).to_vector(allocator) == std::pmr::vector<int>{3, 1, 4, 5, 9, 2, 6});
+    REQUIRE(query.reverse(allocator).to_vector(allocator) == std::pmr::vector<int>{6, 2, 9, 5, 1, 4, 1, 3});
+
+    const auto sorted = query.order_by_ascending([](int i) { return i % 3; }, allocator)
+                            .then_by_descending([](int i) { return i; })
+                            .to_vector(allocator);
+
+    REQUIRE(sorted == std::pmr::vector<int>{9, 6, 3, 4, 1, 1, 5, 2});
+  }
+
+  SECTION("copied queries keep the allocator") {
+    const auto sorted = query.order_by([](int i) { return i; }, linq::sort_direction::descending, allocator);
+    const auto copy   = sorted;
+
+    REQUIRE(copy.take(3).to_vector(allocator) == std::pmr::vector<int>{9, 6, 5});
+  }
+
+  SECTION("terminals") {
+    const auto [even, odd] = query.partition([](int i) { return i % 2 == 0; }, allocator);
+
+    REQUIRE(even == std::pmr::vector<int>{4, 2, 6});
+    REQUIRE(odd == std::pmr::vector<int>{3, 1, 1, 5, 9});
+    REQUIRE(even.get_allocator().resource() == &arena);
+
+    const auto pairs = query.select([](int i) { return std::pair{i, i * i}; });
+
+    REQUIRE(pairs.to_map(allocator).at(9) == 81);
+    REQUIRE(pairs.to_unordered_map(allocator).at(6) == 36);
+  }
+
+  SECTION("chunk, window and tee buffers") {
+    const auto filtered = query.where([](int i) { return i > 1; }); // Not contiguous, so it's buffered.
+
+    REQUIRE(filtered.chunk(4, allocator).select([](auto c) { return c.size(); }).to_vector() == std::vector<size_t>{4, 2});
+    REQUIRE(filtered.window(5, allocator).select([](auto w) { return w[0]; }).to_vector() == std::vector{3, 4});
+
+    auto [a, b] = filtered.tee<2>(allocator);
+
+    REQUIRE(a.sum() == 29);
+    REQUIRE(b.max() == 9);
+  }
+
+  SECTION("window aggregates and formatted text") {
+    const auto filtered = query.where([](int i) { return i > 1; });
+
+    REQUIRE(filtered.window_aggregate(3, linq::rolling_min{}, allocator).to_vector() == std::vector{3, 4, 2, 2});
+    REQUIRE(filtered.window_aggregate(3, linq::rolling_max{}, allocator).to_vector() == std::vector{5, 9, 9, 9});
+    REQUIRE(filtered.window_aggregate(2, linq::rolling_sum{}, allocator).to_vector() == std::vector{7, 9, 14, 11, 8});
+
+    // The strings are returned by value and too long for the iterator's buffer, so they're copied to the arena.
+    const auto texts = query.select([](int i) { return std::string(80, static_cast<char>('0' + i)); });
+    const auto last_chars = texts.select_to_string_view({}, allocator).select([](std::string_view t) { return t.back(); });
+    REQUIRE(last_chars.to_vector() == std::vector{'3', '1', '4', '1', '5', '9', '2', '6'});
+  }
+
+  SECTION("parallel aggregation") {
+    linq::inline_executor executor;
+
+    REQUIRE(query.parallel_sum(executor, allocator) == 31);
+    REQUIRE(query.parallel_min(executor, allocator) == 1);
+    REQUIRE(query.parallel_max(executor, allocator) == 9);
+    REQUIRE(query.parallel_average(executor, allocator) == 31.0L / 8);
+    REQUIRE(query.parallel_reproducible_sum(executor, allocator) == 31);
+    REQUIRE(query.parallel_reproducible_average(executor, allocator) == 31.0L / 8);
+    REQUIRE(query.parallel_aggregate([](int a, int b) { return a * b; }, executor, allocator) == 6480);
+    REQUIRE(query.parallel_count(executor, allocator) == 8);
+    REQUIRE(query.parallel_count([](int i) { return i > 3; }, executor, allocator) == 4);
+
+    const auto sorted =
+        query.parallel_order_by([](int i) { return i; }, linq::sort_direction::descending, executor, allocator);
+    REQUIRE(sorted.to_vector(allocator) == std::pmr::vector<int>{9, 6, 5, 4, 3, 2, 1, 1});
+  }
+
+  SECTION("parallel scans") {
+    linq::inline_executor executor;
+
+    const auto sums = query.parallel_scan([](int a, int b) { return a + b; }, executor, allocator);
+    REQUIRE(sums == std::pmr::vector<int>{3, 4, 8, 9, 14, 23, 25, 31});
+    REQUIRE(sums.get_allocator().resource() == &arena);
+
+    const auto offsets = query.where([](int i) { return i > 4; })
+                             .parallel_exclusive_scan(0, [](int a, int b) { return a + b; }, executor, allocator);
+    REQUIRE(offsets == std::pmr::vector<int>{0, 5, 14});
+  }
+
+  SECTION("initializer list") {
+    const auto list = linq::from({5, 6, 7}, allocator);
+
+    REQUIRE(list.sum() == 18);
+    REQUIRE(list.to_vector(allocator) == std::pmr::vector<int>{5, 6, 7});
+  }
+}
+
+// Counts the allocations from the global heap, which a context's own counter can't see.
+static std::atomic<size_t> global_heap_allocations{0};
+
+void* operator new(size_t size) {
+  ++global_heap_allocations;
+
+  if (void* ptr = std::malloc(size > 0 ? size : 1)) {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++global_heap_allocations;
+  return std::malloc(size > 0 ? size : 1);
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+TEST_CASE("execution_context") {
+  std::vector<int> numbers(1000);
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    numbers[i] = static_cast<int>((i * 7919) % 257);
+  }
+
+  linq::execution_context context;
+  const auto              allocator = context.get_allocator();
+
+  const auto query = linq::from(&numbers)
+                         .order_by_ascending([](int i) { return i % 10; }, allocator)
+                         .then_by_descending([](int i) { return i; })
+                         .distinct(allocator)
+                         .reverse(allocator);
+
+  const auto expected = query.to_vector();
+
+  SECTION("steady state") {
+    const auto run = [&] {
+      const auto copy   = query;
+      const auto result = copy.to_vector(allocator);
+      REQUIRE(std::equal(result.begin(), result.end(), expected.begin(), expected.end()));
+    };
+
+    run();
+
+    const size_t warm        = context.heap_allocations();
+    const size_t global_warm = global_heap_allocations;
+    REQUIRE(warm > 0);
+
+    for (int i = 0; i < 10; ++i) {
+      run();
+    }
+
+    REQUIRE(context.heap_allocations() == warm);
+    REQUIRE(global_heap_allocations == global_warm);
+  }
+
+  SECTION("sorting large inputs") {
+    std::vector<int> many(10000);
+    for (size_t i = 0; i < many.size(); ++i) {
+      many[i] = static_cast<int>((i * 7919) % 1009);
+    }
+
+    const auto sorted = linq::from(&many)
+                            .order_by_ascending([](int i) { return i % 100; }, allocator)
+                            .then_by_descending([](int i) { return i; });
+
+    auto expected_sorted = many;
+    std::stable_sort(expected_sorted.begin(), expected_sorted.end(), [](int a, int b) {
+      return a % 100 != b % 100 ? a % 100 < b % 100 : b < a;
+    });
+
+    REQUIRE(sorted.to_vector(allocator) == std::vector<int, decltype(sorted.to_vector(allocator).get_allocator())>(
+                                               expected_sorted.begin(), expected_sorted.end(), allocator));
+
+    const size_t global_warm = global_heap_allocations;
+
+    for (int i = 0; i < 3; ++i) {
+      const auto result = sorted.to_vector(allocator);
+      REQUIRE(result.size() == many.size());
+    }
+
+    REQUIRE(global_heap_allocations == global_warm);
+  }
+
+  SECTION("parallel operators") {
+    std::vector<int> many(13000);
+    for (size_t i = 0; i < many.size(); ++i) {
+      many[i] = static_cast<int>((i * 7919) % 1009);
+    }
+
+    counting_executor executor;
+
+    // Large enough to be sorted in three chunks, one of which has no partner in the first merge round.
+    const auto by_remainder = [](int i) { return i % 100; };
+
+    const auto sorted = linq::from(&many)
+                            .parallel_order_by(by_remainder, linq::sort_direction::ascending, executor, allocator)
+                            .then_by_descending([](int i) { return i; });
+
+    auto expected_sorted = many;
+    std::stable_sort(expected_sorted.begin(), expected_sorted.end(), [](int a, int b) {
+      return a % 100 != b % 100 ? a % 100 < b % 100 : b < a;
+    });
+
+    const auto run = [&] {
+      const auto result = sorted.to_vector(allocator);
+      REQUIRE(std::equal(result.begin(), result.end(), expected_sorted.begin(), expected_sorted.end()));
+      REQUIRE(linq::from(&many).parallel_reproducible_sum(executor, allocator) == linq::from(&many).sum());
+      REQUIRE(linq::from(&many).window_aggregate(50, linq::rolling_max{}, allocator).count() == many.size() - 49);
+    };
+
+    run();
+    REQUIRE(executor.max_task_count > 1);
+
+    const size_t global_warm = global_heap_allocations;
+
+    for (int i = 0; i < 3; ++i) {
+      run();
+    }
+
+    REQUIRE(global_heap_allocations == global_warm);
+  }
+
+  SECTION("allocation size overflow") {
+    linq::execution_context::allocator<uint64_t> typed{&context};
+    REQUIRE_THROWS_AS((void)typed.allocate(std::numeric_limits<size_t>::max() / 4), std::bad_array_new_length);
+  }
+
+  SECTION("trim") {
+    {
+      const auto result = query.to_vector(allocator);
+      REQUIRE(result.size() == expected.size());
+    }
+
+    REQUIRE(context.retained_bytes() > 0);
+
+    context.trim(1024);
+    REQUIRE(context.retained_bytes() <= 1024);
+
+    context.trim();
+    REQUIRE(context.retained_bytes() == 0);
+  }
+}
+
+TEST_CASE("from initializer_list storage") {
+  // Any allocation through this allocator throws.
+  const std::pmr::polymorphic_allocator<int> no_heap{std::pmr::null_memory_resource()};
+
+  SECTION("small lists are stored inline") {
+    const auto query = linq::from({1, 2, 3}, no_heap);
+    const auto copy  = query;
+
+    REQUIRE(copy.sum() == 6);
+    REQUIRE(copy.data() != query.data());
+    REQUIRE(linq::from({4, 5, 6}).select([](int i) { return i * 2; }).to_vector() == std::vector{8, 10, 12});
+  }
+
+  SECTION("large lists are stored on the heap") {
+    REQUIRE_THROWS_AS((void)linq::from({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17}, no_heap),
+                      std::bad_alloc);
+
+    const auto query = linq::from({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17});
+    REQUIRE(query.count() == 17);
+    REQUIRE(query.last() == 17);
+  }
+
+  SECTION("copy and move") {
+    using namespace std::string_literals;
+
+    auto small = linq::from({"a"s, "b"s});
+    auto large = linq::from({"a"s, "b"s, "c"s, "d"s, "e"s, "f"s, "g"s});
+
+    auto moved_small = std::move(small);
+    auto moved_large = std::move(large);
+
+    REQUIRE(moved_small.to_vector() == std::vector{"a"s, "b"s});
+    REQUIRE(moved_large.count() == 7);
+
+    moved_small = moved_large;
+    REQUIRE(moved_small.to_vector() == moved_large.to_vector());
+
+    moved_large = linq::from({"x"s});
+    REQUIRE(moved_large.to_vector() == std::vector{"x"s});
+  }
+
+  SECTION("inside select_many") {
+    const std::vector numbers{1, 0, 2};
+
+    // Every returned range is stored inline, and an empty list yields no elements.
+    const auto query = linq::from(&numbers).select_many([no_heap](int i) {
+      return i == 0 ? linq::from(std::initializer_list<int>{}, no_heap) : linq::from({i, i * 10}, no_heap);
+    });
+
+    REQUIRE(query.to_vector() == std::vector{1, 10, 2, 20});
+
+    // Copies of an iterator walk their own copy of the returned range.
+    auto it = [&] {
+      auto first = query.begin();
+      ++first;
+      return first;
+    }();
+
+    REQUIRE(*it == 10);
+    ++it;
+    REQUIRE(*it == 2);
+  }
+}
+
+TEST_CASE("element references") {
+  struct row {
+    int                 id{};
+    std::array<int, 64> payload{};
+  };
+
+  std::vector<row> rows;
+  for (int i = 0; i < 5; ++i) {
+    rows.push_back(row{i * 10, {}});
+  }
+
+  const auto& const_rows = rows;
+  const auto  query      = linq::from(&const_rows);
+
+  SECTION("first and last") {
+    REQUIRE(query.first_ref() == &rows.front());
+    REQUIRE(query.last_ref() == &rows.back());
+    REQUIRE(query.first_ref([](const row& r) { return r.id > 15; }) == &rows[2]);
+    REQUIRE(query.last_ref([](const row& r) { return r.id < 25; }) == &rows[2]);
+    REQUIRE(query.first_ref([](const row& r) { return r.id > 100; }) == nullptr);
+  }
+
+  SECTION("element_at") {
+    REQUIRE(query.element_at_ref(3) == &rows[3]);
+    REQUIRE(query.element_at_ref(5) == nullptr);
+
+    const auto filtered = query.where([](const row& r) { return r.id != 10; });
+    REQUIRE(filtered.element_at_ref(1) == &rows[2]);
+    REQUIRE(filtered.last_ref() == &rows[4]);
+  }
+
+  SECTION("sorted") {
+    const auto sorted = query.order_by_descending([](const row& r) { return r.id; });
+    const row* top    = sorted.first_ref();
+
+    REQUIRE(top != nullptr);
+    REQUIRE(top->id == 40);
+    REQUIRE(sorted.element_at_ref(4)->id == 0);
+  }
+
+  SECTION("mutable") {
+    row* found = linq::from_mutable(&rows).first_ref([](const row& r) { return r.id == 30; });
+
+    REQUIRE(found == &rows[3]);
+    found->id = 31;
+    REQUIRE(rows[3].id == 31);
+  }
+
+  SECTION("empty") {
+    const std::vector<row> empty;
+
+    REQUIRE(linq::from(&empty).first_ref() == nullptr);
+    REQUIRE(linq::from(&empty).last_ref() == nullptr);
+    REQUIRE(linq::from(&empty).element_at_ref(0) == nullptr);
+  }
+
+  SECTION("stored elements") {
+    // first_ref and friends refuse temporaries of these, since the elements would be destroyed with them.
+    const std::vector ids{3, 1, 4, 2};
+    const auto        identity = [](int i) { return i; };
+    const auto        is_big   = [](int i) { return i > 1; };
+    const auto        row_id   = [](const row& r) { return r.id; };
+
+    using sorted_t          = decltype(linq::from(&ids).order_by_ascending(identity));
+    using filtered_sorted_t = decltype(linq::from(&ids).order_by_ascending(identity).where(is_big).take(2));
+    using inline_t          = decltype(linq::from({1, 2, 3}).skip(1));
+    using view_t            = decltype(linq::from(&ids).where(is_big).reverse());
+    using rows_by_ref_t     = decltype(linq::from(&rows).order_by_ascending(row_id));
+
+    static_assert(sorted_t::holds_elements && filtered_sorted_t::holds_elements && inline_t::holds_elements);
+    static_assert(!view_t::holds_elements && !rows_by_ref_t::holds_elements);
+
+    const auto filtered_sorted = linq::from(&ids).order_by_descending(identity).where(is_big);
+    REQUIRE(*filtered_sorted.first_ref() == 4);
+  }
+
+}
+
+TEST_CASE("reference projections") {
+  struct person {
+    std::string name;
+    int         age{};
+  };
+
+  const std::vector<person> people{{"Carol", 31}, {"Alice", 25}, {"Bob", 42}};
+  const auto                query = linq::from(&people);
+
+  SECTION("select_member") {
+    const auto names = query.select_member(&person::name);
+
+    static_assert(std::is_same_v<decltype(*names.begin()), const std::string&>);
+
+    REQUIRE(&*names.begin() == &people[0].name);
+    REQUIRE(names.to_vector() == std::vector<std::string>{"Carol", "Alice", "Bob"});
+    REQUIRE(names.min() == "Alice");
+    REQUIRE(names.max() == "Carol");
+  }
+
+  SECTION("select_ref") {
+    const auto names = query.select_ref([](const person& p) -> const std::string& { return p.name; });
+
+    REQUIRE(names.first_ref() == &people[0].name);
+    REQUIRE(names.last_ref() == &people[2].name);
+  }
+
+  SECTION("downstream stages keep references") {
+    const auto names = query.select_member(&person::name);
+
+    const auto filtered = names.where([](const std::string& n) { return n != "Alice"; }).skip(1);
+    REQUIRE(filtered.first_ref() == &people[2].name);
+
+    // Strings are sorted by address instead of being copied.
+    const auto sorted = names.order_by_ascending([](const std::string& n) { return n.size(); })
+                            .then_by_descending([](const std::string& n) { return n; });
+
+    REQUIRE(sorted.to_vector() == std::vector<std::string>{"Bob", "Carol", "Alice"});
+    REQUIRE(sorted.first_ref() == &people[2].name);
+  }
+
+  SECTION("computed values") {
+    // Filtering computed values doesn't hand out references to temporaries.
+    const auto greetings = query.select([](const person& p) { return "Hello " + p.name; })
+                               .where([](const std::string& s) { return s.size() > 9; })
+                               .take(2);
+
+    REQUIRE(greetings.to_vector() == std::vector<std::string>{"Hello Carol", "Hello Alice"});
+    REQUIRE(greetings.reverse().first() == "Hello Alice");
+  }
+}
+
+namespace {
+struct copy_counter {
+  static inline int copies = 0;
+
+  copy_counter() = default;
+
+  explicit copy_counter(int v)
+      : value(v) {
+  }
+
+  copy_counter(const copy_counter& other)
+      : value(other.value) {
+    ++copies;
+  }
+
+  copy_counter(copy_counter&&) noexcept = default;
+
+  copy_counter& operator=(const copy_counter& other) {
+    value = other.value;
+    ++copies;
+    return *this;
+  }
+
+  copy_counter& operator=(copy_counter&&) noexcept = default;
+
+  bool operator<(const copy_counter& other) const {
+    return value < other.value;
+  }
+
+  int value{};
+};
+} // namespace
+
+TEST_CASE("moving terminals") {
+  const std::vector numbers{3, 1, 2};
+
+  SECTION("computed values are moved") {
+    copy_counter::copies = 0;
+
+    const auto values = linq::from(&numbers).select([](int i) { return copy_counter{i}; }).to_vector();
+
+    REQUIRE(values.size() == 3);
+    REQUIRE(copy_counter::copies == 0);
+
+    const auto [big, small] =
+        linq::from(&numbers).select([](int i) { return copy_counter{i}; }).partition([](const copy_counter& c) {
+          return c.value > 1;
+        });
+
+    REQUIRE(big.size() == 2);
+    REQUIRE(small.size() == 1);
+    REQUIRE(copy_counter::copies == 0);
+  }
+
+  SECTION("owned elements are moved out of rvalue ranges") {
+    std::vector<copy_counter> source;
+    for (int i : numbers) {
+      source.emplace_back(i);
+    }
+
+    copy_counter::copies = 0;
+
+    auto owned  = linq::from_copy(std::move(source));
+    auto values = std::move(owned).to_vector();
+
+    REQUIRE(values.size() == 3);
+    REQUIRE(values[0].value == 3);
+    REQUIRE(copy_counter::copies == 0);
+
+    // The sort buffer is filled with computed values, which it owns.
+    auto sorted = linq::from(&numbers)
+                      .select([](int i) { return copy_counter{i}; })
+                      .order_by_ascending([](const copy_counter& c) { return c.value; });
+
+    const auto sorted_values = std::move(sorted).to_vector();
+
+    REQUIRE(sorted_values.size() == 3);
+    REQUIRE(sorted_values[0].value == 1);
+    REQUIRE(sorted_values[2].value == 3);
+    REQUIRE(copy_counter::copies == 0);
+  }
+
+  SECTION("lvalue ranges are left intact") {
+    const auto owned = linq::from_copy(std::vector{1, 2, 3});
+
+    REQUIRE(owned.to_vector() == std::vector{1, 2, 3});
+    REQUIRE(owned.count() == 3);
+  }
+
+  SECTION("maps") {
+    auto pairs = linq::from_copy(std::vector<std::pair<int, std::string>>{{1, "one"}, {2, "two"}});
+
+    REQUIRE(pairs.to_map().at(2) == "two");
+    REQUIRE(std::move(pairs).to_unordered_map().at(1) == "one");
+  }
+}
+
+TEST_CASE("container sinks") {
+  const std::vector numbers{5, 3, 8, 1};
+  const auto        query = linq::from(&numbers);
+
+  SECTION("assign_to keeps capacity") {
+    std::vector<int> out;
+    out.reserve(16);
+    out.push_back(42);
+
+    const int* storage = out.data();
+
+    REQUIRE(query.assign_to(out) == std::vector{5, 3, 8, 1});
+    REQUIRE(out.data() == storage);
+
+    query.where([](int i) { return i > 4; }).into(out);
+    REQUIRE(out == std::vector{5, 8});
+    REQUIRE(out.data() == storage);
+  }
+
+  SECTION("append_to") {
+    std::vector<int> out{0};
+    query.take(2).append_to(out);
+    REQUIRE(out == std::vector{0, 5, 3});
+
+    std::deque<int> deque{0};
+    query.append_to(deque);
+    REQUIRE(deque == std::deque{0, 5, 3, 8, 1});
+  }
+
+  SECTION("append_to repeatedly") {
+    std::vector<int> out;
+    size_t           reallocations = 0;
+
+    for (int i = 0; i < 100; ++i) {
+      const size_t capacity = out.capacity();
+      query.append_to(out);
+
+      if (out.capacity() != capacity) {
+        REQUIRE(out.capacity() >= 2 * capacity);
+        ++reallocations;
+      }
+    }
+
+    REQUIRE(out.size() == 400);
+    REQUIRE(reallocations <= 8);
+
+    std::unordered_set<int> set;
+    for (int i = 0; i < 100; ++i) {
+      linq::from_to(i * 4, i * 4 + 3).append_to(set);
+    }
+
+    REQUIRE(set.size() == 400);
+  }
+
+  SECTION("associative containers") {
+    std::set<int> set{100};
+    query.append_to(set);
+    REQUIRE(set == std::set{1, 3, 5, 8, 100});
+
+    query.take(1).assign_to(set);
+    REQUIRE(set == std::set{5});
+
+    std::map<int, int> map;
+    query.select([](int i) { return std::pair{i, i * 2}; }).into(map);
+    REQUIRE(map.size() == 4);
+    REQUIRE(map.at(8) == 16);
+  }
+}
+
+TEST_CASE("select_to_string_view") {
+  SECTION("integers") {
+    const std::vector<int64_t> numbers{0, -42, 1234567890123456789};
+
+    std::vector<std::string> result;
+    for (std::string_view text : linq::from(&numbers).select_to_string_view()) {
+      result.emplace_back(text);
+    }
+
+    REQUIRE(result == std::vector<std::string>{"0", "-42", "1234567890123456789"});
+  }
+
+  SECTION("floating point") {
+    const std::vector numbers{0.5, 1.0 / 3.0, 1e300};
+    const auto        query = linq::from(&numbers);
+
+    const auto to_string = [](std::string_view text) { return std::string(text); };
+
+    REQUIRE(query.select_to_string_view().select(to_string).first() == "0.5");
+    REQUIRE(std::stod(*query.select_to_string_view().select(to_string).element_at(1)) == 1.0 / 3.0);
+
+    const auto fixed = query.select_to_string_view({std::chars_format::fixed, 2});
+    auto       it    = fixed.begin();
+
+    REQUIRE(*it == "0.50");
+    ++it;
+    REQUIRE(*it == "0.33");
+    ++it;
+    REQUIRE((*it).size() == 304); // Doesn't fit into the inline buffer.
+    REQUIRE((*it).view().substr(0, 4) == "1000");
+
+    const auto scientific = query.select_to_string_view({std::chars_format::scientific, 3});
+    REQUIRE(*scientific.begin() == "5.000e-01");
+  }
+
+  SECTION("formats once") {
+    int        calls = 0;
+    const auto query = linq::from({7, 8}).select([&calls](int i) {
+      ++calls;
+      return i;
+    });
+
+    const auto views = query.select_to_string_view();
+    auto       it    = views.begin();
+
+    REQUIRE(*it == "7");
+    REQUIRE(*it == "7");
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("strings pass through") {
+    const std::vector<std::string> words{"a", "bc"};
+
+    REQUIRE(linq::from(&words).select_to_string_view().first()->data() == words[0].data());
+  }
+
+  SECTION("strings returned by value are copied") {
+    const auto query = linq::from({1, 22}).select_to_string().select_to_string_view();
+
+    REQUIRE(query.string_join(",") == "1,22");
+  }
+
+  SECTION("formatted text can't outlive its iterator") {
+    const std::vector numbers{5, 3, 9, 1};
+    const auto        query = linq::from(&numbers).select_to_string_view();
+
+    using output_t = decltype(query)::iterator::output_t;
+
+    // Keeping elements (first, to_vector, max, order_by, ...) would require copying or moving them.
+    static_assert(std::is_same_v<output_t, linq::formatted_text>);
+    static_assert(!std::is_copy_constructible_v<output_t> && !std::is_move_constructible_v<output_t>);
+
+    REQUIRE(query.where([](std::string_view text) { return text != "3"; }).string_join(",") == "5,9,1");
+    REQUIRE(query.select([](std::string_view text) { return std::string(text); }).max() == "9");
+  }
+}
+
+TEST_CASE("string_join") {
+  using namespace std::string_literals;
+
+  SECTION("strings") {
+    const std::vector words{"alpha"s, "beta"s, "gamma"s};
+    const auto        joined = linq::from(&words).string_join(", ");
+
+    REQUIRE(joined == "alpha, beta, gamma");
+    REQUIRE(joined.capacity() - joined.size() < 16);
+  }
+
+  SECTION("single pass over computed ranges") {
+    const std::vector words{"alpha"s, "beta"s, "gamma"s};
+
+    int        calls = 0;
+    const auto query = linq::from(&words).where([&calls](const std::string& word) {
+      ++calls;
+      return word != "beta";
+    });
+
+    REQUIRE(query.string_join(", ") == "alpha, gamma");
+    REQUIRE(calls == 3);
+  }
+
+  SECTION("numbers and characters") {
+    REQUIRE(linq::from({1, -2, 3}).string_join(",") == "1,-2,3");
+    REQUIRE(linq::from({0.5, 2.0}).string_join(" ") == "0.5 2");
+    REQUIRE(linq::from({'a', 'b', 'c'}).string_join("") == "abc");
+  }
+
+  SECTION("formatter") {
+    struct item {
+      std::string name;
+      int         count{};
+    };
+
+    const std::vector<item> items{{"apples", 3}, {"pears", 5}};
+
+    REQUIRE(linq::from(&items).string_join("; ", [](const item& i) { return i.name + "=" + std::to_string(i.count); }) ==
+            "apples=3; pears=5");
+
+    REQUIRE(linq::from(&items).string_join(",", [](std::string& out, const item& i) { out += i.name; }) ==
+            "apples,pears");
+  }
+
+  SECTION("empty") {
+    const std::vector<std::string> empty;
+
+    REQUIRE(linq::from(&empty).string_join(", ").empty());
+    REQUIRE(linq::from({"x"s}).string_join(", ") == "x");
+  }
+}
+
+TEST_CASE("contiguous sources") {
+  const int array[]{4, 8, 15, 16, 23, 42};
+
+  SECTION("pointer and count") {
+    const auto query = linq::from(array + 1, 3);
+
+    REQUIRE(query.to_vector() == std::vector{8, 15, 16});
+    REQUIRE(query.element_at_ref(2) == &array[3]);
+    REQUIRE(linq::from(static_cast<const int*>(nullptr), 0).count() == 0);
+  }
+
+  SECTION("array") {
+    const auto query = linq::from(array);
+
+    REQUIRE(query.count() == 6);
+    REQUIRE(query.sum() == 108);
+    REQUIRE(query.last_ref() == &array[5]);
+    REQUIRE(query.window(2).first()->data() == array);
+    REQUIRE(query.parallel_sum() == 108);
+  }
+
+  SECTION("span") {
+    const std::vector values{1, 2, 3, 4};
+
+    const auto query = linq::from(std::span{values}.subspan(1));
+    REQUIRE(query.to_vector() == std::vector{2, 3, 4});
+
+    const auto fixed = linq::from(std::span<const int, 2>{values.data(), 2});
+    REQUIRE(fixed.to_vector() == std::vector{1, 2});
+  }
+
+  SECTION("mutable") {
+    int values[]{1, 2, 3};
+
+    for (int& i : linq::from_mutable(values)) {
+      i *= 10;
+    }
+
+    *linq::from_mutable(values, 3).first_ref() = 5;
+
+    REQUIRE(linq::from(values).to_vector() == std::vector{5, 20, 30});
+  }
+}
+
+TEST_CASE("unordered sources") {
+  std::unordered_map<int, int> squares;
+  std::unordered_set<int>      keys;
+
+  for (int i = 0; i < 50000; ++i) {
+    squares.emplace(i, (i % 100) * (i % 100));
+    keys.insert(i * 3);
+  }
+
+  SECTION("sequential") {
+    const auto query = linq::from(&squares).where([](const auto& p) { return p.first < 10; });
+
+    REQUIRE(query.count() == 10);
+    REQUIRE(query.select([](const auto& p) { return p.second; }).order_by_ascending([](int i) { return i; }).first() ==
+            0);
+    REQUIRE(linq::from(&keys).count([](int i) { return i % 2 == 0; }) == 25000);
+  }
+
+  SECTION("parallel by bucket") {
+    linq::thread_pool pool{4};
+
+    const auto values = linq::from(&squares).select([](const auto& p) { return int64_t{p.second}; });
+
+    REQUIRE(values.parallel_sum(pool) == values.sum());
+    REQUIRE(values.parallel_max(pool) == 99 * 99);
+    REQUIRE(linq::from(&squares).parallel_count(pool) == squares.size());
+    REQUIRE(linq::from(&keys).parallel_count([](int i) { return i % 2 == 0; }, pool) == 25000);
+    REQUIRE(linq::from(&keys).parallel_min(pool) == 0);
+  }
+
+  SECTION("empty") {
+    const std::unordered_map<int, int> empty;
+
+    REQUIRE(linq::from(&empty).parallel_count() == 0);
+    REQUIRE(linq::from(&empty).select([](const auto& p) { return p.second; }).parallel_sum().has_value() == false);
+  }
+
+  SECTION("mutable") {
+    for (auto& p : linq::from_mutable(&squares).where([](const auto& p) { return p.first == 7; })) {
+      p.second = -1;
+    }
+
+    REQUIRE(squares.at(7) == -1);
+  }
+}
+
+TEST_CASE("key ranges") {
+  const std::map<int, char> letters{{1, 'a'}, {2, 'b'}, {3, 'c'}, {5, 'e'}, {8, 'h'}};
+  const std::set<std::string, std::less<>> words{"apple", "banana", "cherry", "date"};
+
+  const auto keys = [](const auto& p) { return p.first; };
+
+  SECTION("bounds") {
+    const auto query = linq::from(&letters);
+
+    REQUIRE(query.where_key_between(2, 5).select(keys).to_vector() == std::vector{2, 3});
+    REQUIRE(query.where_key_at_least(4).select(keys).to_vector() == std::vector{5, 8});
+    REQUIRE(query.where_key_greater_than(5).select(keys).to_vector() == std::vector{8});
+    REQUIRE(query.where_key_less_than(3).select(keys).to_vector() == std::vector{1, 2});
+    REQUIRE(query.where_key_at_most(3).select(keys).to_vector() == std::vector{1, 2, 3});
+  }
+
+  SECTION("empty ranges") {
+    const auto query = linq::from(&letters);
+
+    REQUIRE(query.where_key_between(3, 3).count() == 0);
+    REQUIRE(query.where_key_between(5, 2).count() == 0);
+    REQUIRE(query.where_key_at_least(9).first().has_value() == false);
+    REQUIRE(query.where_key_less_than(0).count() == 0);
+  }
+
+  SECTION("composition and heterogeneous keys") {
+    const auto query = linq::from(&words).where_key_between(std::string_view{"b"}, std::string_view{"d"});
+
+    REQUIRE(query.to_vector() == std::vector<std::string>{"banana", "cherry"});
+    REQUIRE(query.where([](const std::string& s) { return s.size() > 6; }).count() == 0);
+    REQUIRE(query.first_ref() == &*words.find("banana"));
+  }
+
+  SECTION("bounds are found on iteration") {
+    std::map<int, char> mutable_letters = letters;
+
+    const auto query = linq::from(&mutable_letters).where_key_between(2, 4);
+    mutable_letters.erase(2);
+    mutable_letters.emplace(3, 'x');
+    mutable_letters.emplace(4, 'd');
+
+    REQUIRE(query.select(keys).to_vector() == std::vector{3});
+  }
+}
+
+TEST_CASE("contains and find_key") {
+  const std::set<int>                    primes{2, 3, 5, 7, 11};
+  const std::map<std::string, int>       ages{{"alice", 31}, {"bob", 27}};
+  const std::unordered_set<int>          ids{10, 20, 30};
+  const std::multimap<int, char>         grades{{1, 'a'}, {1, 'b'}, {2, 'c'}};
+  const std::vector<std::pair<int, int>> pairs{{1, 10}, {2, 20}};
+
+  SECTION("associative sources") {
+    REQUIRE(linq::from(&primes).contains(7));
+    REQUIRE(linq::from(&primes).contains(8) == false);
+    REQUIRE(linq::from(&ids).contains(20));
+    REQUIRE(linq::from(&ages).contains(std::pair<const std::string, int>{"bob", 27}));
+    REQUIRE(linq::from(&ages).contains(std::pair<const std::string, int>{"bob", 28}) == false);
+    REQUIRE(linq::from(&grades).contains(std::pair<const int, char>{1, 'b'}));
+
+    const std::map<int, int> squares{{1, 1}, {2, 4}, {3, 9}};
+
+    REQUIRE(linq::from(&squares).contains(std::pair<int, int>{2, 4}));
+    REQUIRE(linq::from(&squares).contains(std::pair<int, int>{2, 5}) == false);
+    REQUIRE(linq::from(&squares).contains(std::pair<int, int>{4, 4}) == false);
+    REQUIRE(linq::from(&grades).contains(std::pair<int, char>{1, 'b'}));
+    REQUIRE(linq::from(&grades).contains(std::pair<int, char>{2, 'a'}) == false);
+    REQUIRE(linq::from(&squares).where([](const auto& p) { return p.first > 1; }).contains(std::pair<int, int>{3, 9}));
+    REQUIRE(linq::from(&pairs).contains(std::pair<const int, int>{2, 20}));
+
+    REQUIRE(linq::from(&ages).find_key("alice")->second == 31);
+    REQUIRE(linq::from(&ages).find_key("carol").has_value() == false);
+    REQUIRE(linq::from(&ids).find_key(30) == 30);
+    REQUIRE(linq::from_copy(primes).find_key(11) == 11);
+  }
+
+  SECTION("other ranges") {
+    const std::vector<int> numbers{4, 8, 15};
+
+    REQUIRE(linq::from(&numbers).contains(15));
+    REQUIRE(linq::from(&numbers).contains(16) == false);
+    REQUIRE(linq::from(&primes).where([](int i) { return i > 5; }).contains(3) == false);
+    REQUIRE(linq::from(&primes).select([](int i) { return i * 2; }).contains(22));
+
+    REQUIRE(linq::from(&pairs).find_key(2)->second == 20);
+    REQUIRE(linq::from(&ages).where([](const auto& p) { return p.second > 30; }).find_key("bob").has_value() == false);
+    REQUIRE(linq::from(&numbers).find_key(8) == 8);
+  }
+}
+
+TEST_CASE("from_to closed form") {
+  SECTION("aggregates") {
+    const auto range = linq::from_to(3, 20, 4); // 3, 7, 11, 15, 19
+
+    REQUIRE(range.count() == 5);
+    REQUIRE(range.sum() == 55);
+    REQUIRE(range.min() == 3);
+    REQUIRE(range.max() == 19);
+    REQUIRE(range.last() == 19);
+    REQUIRE(range.element_at(2) == 11);
+    REQUIRE(range.element_at(5).has_value() == false);
+    REQUIRE(range.to_vector() == std::vector{3, 7, 11, 15, 19});
+  }
+
+  SECTION("no intermediate overflow") {
+    constexpr int max = std::numeric_limits<int>::max();
+
+    const auto range = linq::from_to(max - 2, max);
+    REQUIRE(range.to_vector() == std::vector{max - 2, max - 1, max});
+    REQUIRE(range.last() == max);
+
+    REQUIRE(linq::from_to(-1000000, 1000000).sum() == 0);
+    REQUIRE(linq::from_to(int64_t{1}, int64_t{3000000000}).sum() == int64_t{4500000001500000000});
+    REQUIRE(linq::from_to(uint8_t{250}, uint8_t{255}).count() == 6);
+  }
+
+  SECTION("count limit") {
+    constexpr auto max = std::numeric_limits<size_t>::max();
+
+    REQUIRE(linq::from_to(size_t{1}, max).count() == max);
+    REQUIRE(linq::from_to(size_t{1}, max).last() == max);
+    REQUIRE_THROWS_AS((void)linq::from_to(size_t{0}, max), std::length_error);
+  }
+
+  SECTION("invalid step") {
+    REQUIRE_THROWS_AS((void)linq::from_to(0, 10, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS((void)linq::from_to(0, 10, -2), std::invalid_argument);
+    REQUIRE_THROWS_AS((void)linq::from_to(0.0, 1.0, 0.0), std::invalid_argument);
+  }
+
+  SECTION("count doesn't transform indexed elements") {
+    int        calls = 0;
+    const auto query = linq::from_to(1, 10).select([&calls](int i) {
+      ++calls;
+      return i;
+    });
+
+    REQUIRE(query.count() == 10);
+    REQUIRE(query.last() == 10);
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("parallel") {
+    const auto squares = linq::from_to(int64_t{0}, int64_t{100000}).select([](int64_t i) { return i * i; });
+
+    REQUIRE(squares.parallel_sum() == squares.sum());
+    REQUIRE(squares.parallel_count() == 100001);
+    REQUIRE(squares.element_at(300) == 90000);
+  }
+}
+
+TEST_CASE("generate_indexed") {
+  const auto squares = linq::generate_indexed(1000, [](size_t i) { return int64_t(i * i); });
+
+  SECTION("sequential") {
+    REQUIRE(squares.count() == 1000);
+    REQUIRE(squares.take(4).to_vector() == std::vector<int64_t>{0, 1, 4, 9});
+    REQUIRE(squares.element_at(999) == 998001);
+    REQUIRE(squares.last() == 998001);
+    REQUIRE(linq::generate_indexed(0, [](size_t i) { return i; }).first().has_value() == false);
+  }
+
+  SECTION("constant-time skip") {
+    size_t calls = 0;
+
+    const auto counted = linq::generate_indexed(1000000, [&calls](size_t i) {
+      ++calls;
+      return i;
+    });
+
+    REQUIRE(counted.skip(999998).to_vector() == std::vector<size_t>{999998, 999999});
+    REQUIRE(calls == 2);
+    REQUIRE(counted.skip(5).count() == 999995);
+    REQUIRE(counted.skip(2000000).count() == 0);
+    REQUIRE(counted.skip(10).element_at(3) == 13);
+  }
+
+  SECTION("parallel") {
+    linq::thread_pool pool{4};
+
+    REQUIRE(squares.parallel_sum(pool) == squares.sum());
+    REQUIRE(squares.skip(100).parallel_max(pool) == 998001);
+    REQUIRE(squares.where([](int64_t i) { return i % 2 == 0; }).parallel_count(pool) == 500);
+  }
+
+  SECTION("skip on other indexed ranges") {
+    const std::vector numbers{1, 2, 3, 4, 5};
+
+    REQUIRE(linq::from(&numbers).skip(3).to_vector() == std::vector{4, 5});
+    REQUIRE(linq::from(&numbers).skip(2).parallel_sum() == 12);
+    REQUIRE(linq::from(&numbers).skip(7).to_vector().empty());
+    REQUIRE(linq::from_to(1, 10).skip(8).sum() == 19);
+  }
+}
+
+#ifdef __cpp_lib_coroutine
+namespace {
+linq::generator<std::string_view> split(std::string_view text, char separator) {
+  while (!text.empty()) {
+    const auto pos = text.find(separator);
+    co_yield text.substr(0, pos);
+    text.remove_prefix(pos == std::string_view::npos ? text.size() : pos + 1);
+  }
+}
+
+linq::generator<int> iota(int first, int last) {
+  for (int i = first; i < last; ++i) {
+    co_yield i;
+  }
+}
+
+linq::generator<int> nested_iota() {
+  co_yield 0;
+  co_yield linq::elements_of(iota(1, 3));
+  co_yield linq::elements_of(iota(3, 3));
+  co_yield 3;
+}
+
+linq::generator<copy_counter> counters(int count) {
+  copy_counter value{0};
+
+  for (; value.value < count; ++value.value) {
+    co_yield value;
+  }
+}
+
+linq::generator<int> failing() {
+  co_yield 1;
+  throw std::runtime_error("failed");
+}
+
+linq::generator<int> nested_failing() {
+  co_yield linq::elements_of(failing());
+  co_yield 2;
+}
+} // namespace
+
+TEST_CASE("from_coroutine") {
+  SECTION("stream parsing") {
+    const auto words = linq::from_coroutine(split("the quick brown fox", ' '))
+                           .where([](std::string_view word) { return word.size() > 3; })
+                           .to_vector();
+
+    REQUIRE(words == std::vector<std::string_view>{"quick", "brown"});
+    REQUIRE(linq::from_coroutine(split("", ' ')).count() == 0);
+  }
+
+  SECTION("nested generators") {
+    REQUIRE(linq::from_coroutine(nested_iota()).to_vector() == std::vector{0, 1, 2, 3});
+  }
+
+  SECTION("references to the frame value") {
+    copy_counter::copies = 0;
+
+    const auto query = linq::from_coroutine(counters(5))
+                           .where([](const copy_counter& c) { return c.value % 2 == 0; })
+                           .select([](const copy_counter& c) { return c.value; });
+
+    REQUIRE(query.to_vector() == std::vector{0, 2, 4});
+    REQUIRE(copy_counter::copies == 0);
+  }
+
+  SECTION("single pass") {
+    const auto query = linq::from_coroutine(iota(0, 5));
+
+    REQUIRE(query.take(2).to_vector() == std::vector{0, 1});
+    REQUIRE(query.to_vector() == std::vector{2, 3, 4});
+  }
+
+  SECTION("exceptions") {
+    REQUIRE_THROWS_AS((void)linq::from_coroutine(failing()).count(), std::runtime_error);
+    REQUIRE_THROWS_AS((void)linq::from_coroutine(nested_failing()).count(), std::runtime_error);
+  }
+}
+#endif